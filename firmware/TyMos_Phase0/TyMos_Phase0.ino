@@ -26,37 +26,60 @@
 #include "config.h"
 #include "core_display_manager.h"
 #include "core_settings_manager.h"
+#include "hw_i2c_bus.h"
 #include "hw_pca9685.h"
 #include "hw_rtc.h"
 #include "hw_wifi.h"
+#include "motion_calibration.h"
 #include "motion_collision.h"
 #include "motion_engine.h"
+#include "motion_pose_store.h"
+#include "motion_scheduler.h"
 #include "motion_segment_map.h"
 #include "motion_servo.h"
+#include "motion_task.h"
+#include "utils_bench.h"
 #include "utils_logger.h"
+#include "utils_profiler.h"
+#include "utils_trace.h"
 
 // Global Objects
 HwPCA9685 pwmDriver;
 RTCDriver rtcDriver;
 HwWiFi wifiManager;
 MotionServo motionServo(&pwmDriver);
-MotionCollision motionCollision(&motionServo);
-MotionEngine motionEngine(&motionServo, &motionCollision);
-CoreDisplayManager displayManager(&rtcDriver, &motionEngine);
+MotionScheduler motionScheduler(&motionServo);
+MotionCollision motionCollision(&motionScheduler);
+MotionEngine motionEngine(&motionServo, &motionCollision, &motionScheduler);
+MotionTask motionTask(&motionEngine);
+CoreDisplayManager displayManager(&rtcDriver, &motionTask);
+
+void controlTask(void *arg);
 
 void setup() {
   // 1. Initialize Logger
   Logger.begin();
   Logger.info("Booting TyMos v2.0...");
+  Profiler.begin();
 
   // 2. Initialize Hardware
   // I2C Setup
   Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
-  Wire.setClock(I2C_CLOCK_SPEED);
+
+  // I2C bus manager: owns Wire from here on (clock, timeouts, recovery),
+  // drivers queue transactions
+  I2CBus.begin();
 
   // PWM Driver (Hours & Minutes)
   pwmDriver.begin(PCA9685_ADDR_HOURS, PCA9685_ADDR_MINUTES, PCA9685_PWM_FREQ);
 
+  // Servo calibration (NVS) -> per-channel pulse tables
+  Calibration.begin();
+  motionServo.loadCalibration();
+
+  // User settings (NVS): speed, night window, stagger
+  Settings.begin();
+
   // RTC
   if (!rtcDriver.begin()) {
     Logger.error("RTC Initialization Failed!");
@@ -65,43 +88,53 @@ void setup() {
               rtcDriver.getTemperature());
 
   // 3. WiFi, NTP and OTA
-  // Try to connect and sync time from NTP
-  if (!wifiManager.begin()) {
-    // WiFi failed, fallback to compile time
-    Logger.warning("Using compile time as fallback");
-    rtcDriver.syncWithCompileTime();
+  // Connects in the background; the display starts from RTC time and NTP
+  // time is written to the RTC whenever it arrives
+  wifiManager.begin();
+
+  // 4. Servo pose: after a reset that did not move anything (OTA, brownout,
+  // watchdog) the last pose is still valid and homing is skipped; a power
+  // cycle always homes
+  DisplayState pose;
+  if (!PoseStore.load(pose)) {
+    motionEngine.homeQuick(pose);
   }
 
-  // 4. Initial Reset Sequence
-  motionEngine.resetSequence();
-
-  // 5. Configure Speed Based on Time (Night Mode: 22:00 - 07:00)
+  // 5. Configure Speed Based on Time (night window from Settings)
   DateTime now = rtcDriver.now();
-  if (now.hour() >= 22 || now.hour() < 7) {
+  if (Settings.isNightTime(now.hour(), now.minute())) {
     Settings.setNightMode(true);
-    Logger.info("Night mode enabled (22:00-07:00)");
-  } else {
-    Settings.setSpeed(SPEED_NORMAL);
+    Logger.info("Night mode enabled (%02d:%02d-%02d:%02d)",
+                Settings.getNightStart() / 60, Settings.getNightStart() % 60,
+                Settings.getNightEnd() / 60, Settings.getNightEnd() % 60);
   }
 
-  // 6. Start Display Manager
-  displayManager.begin();
+  // 6. Motion stack moves to its own task on core 1; from here on it is
+  // only driven through motionTask commands
+  motionTask.begin(pose);
+
+  // 7. Start Display Manager
+  displayManager.begin(pose);
+
+  // 8. Control side (network, clock, display decisions) on core 0
+  xTaskCreatePinnedToCore(controlTask, "control", CONTROL_TASK_STACK, NULL,
+                          CONTROL_TASK_PRIORITY, NULL, CONTROL_TASK_CORE);
 
   Logger.info("Setup Complete. Entering Loop.");
 }
 
-// Track last hour for night mode transition
-static int lastHourChecked = -1;
+// Track last minute for night mode transition
+static int lastMinuteChecked = -1;
 
 void checkNightMode() {
   DateTime now = rtcDriver.now();
-  int currentHour = now.hour();
+  int currentMinute = now.hour() * 60 + now.minute();
 
-  // Only check when hour changes
-  if (currentHour != lastHourChecked) {
-    lastHourChecked = currentHour;
+  // Only check when minute changes (the window has minute resolution)
+  if (currentMinute != lastMinuteChecked) {
+    lastMinuteChecked = currentMinute;
 
-    bool shouldBeNight = (currentHour >= 22 || currentHour < 7);
+    bool shouldBeNight = Settings.isNightTime(now.hour(), now.minute());
     bool isCurrentlyNight = Settings.isNightMode();
 
     if (shouldBeNight && !isCurrentlyNight) {
@@ -114,22 +147,87 @@ void checkNightMode() {
   }
 }
 
-void loop() {
-  // 1. Handle OTA updates
+// Serial console: 't' toggles event tracing, 'd' dumps the trace buffer
+// (convert with host-sim/tools/trace_timeline.py), 'p' logs the loop
+// profile, 'b' runs the microbenchmarks (BENCH_ENABLED builds)
+void handleSerialCommands() {
+  while (Serial.available()) {
+    switch (Serial.read()) {
+    case 't':
+      Trace.enable(!Trace.isEnabled());
+      Logger.info("Tracing %s", Trace.isEnabled() ? "on" : "off");
+      break;
+    case 'd':
+      Logger.flush();
+      Trace.dump();
+      break;
+    case 'p':
+      Profiler.report();
+      break;
+#if BENCH_ENABLED
+    case 'b':
+      benchRunAll();
+      break;
+#endif
+    default:
+      break;
+    }
+  }
+}
+
+void controlLoop() {
+  // Every stage is timed into Profiler (see utils_profiler.h)
+  uint32_t start = Profiler.now();
+  uint32_t t = start;
+
+  // 1. WiFi reconnects and NTP -> RTC (non-blocking)
+  wifiManager.update();
+  t = Profiler.lap(PROF_WIFI, t);
+
+  // 2. Handle OTA updates
   wifiManager.handleOTA();
+  t = Profiler.lap(PROF_OTA, t);
 
-  // 2. Check for periodic NTP sync (every 12 hours)
-  wifiManager.checkPeriodicSync();
+  // 3. Keep the software clock anchored to the DS3231 (checkNightMode and
+  // the display read the software clock)
+  rtcDriver.update();
+  t = Profiler.lap(PROF_RTC, t);
 
-  // 3. Check for automatic night mode transition
+  // 4. Check for automatic night mode transition
   checkNightMode();
+  t = Profiler.lap(PROF_NIGHT_MODE, t);
 
-  // 4. Motion Engine Tick (Handle idle, etc)
-  motionEngine.tick();
+  // 5. Write back settings changed in the last few seconds
+  Settings.update();
+  t = Profiler.lap(PROF_SETTINGS, t);
 
-  // 5. Display Update
+  // 6. Display Update (posts changes to the motion task)
   displayManager.update();
+  t = Profiler.lap(PROF_DISPLAY, t);
+
+  // 7. Trace and profile commands from the serial console
+  handleSerialCommands();
+  t = Profiler.lap(PROF_SERIAL, t);
 
-  // Small delay to prevent CPU hogging
-  delay(1);
+  Profiler.record(PROF_CONTROL_LOOP, t - start);
+  Profiler.update();
+}
+
+void controlTask(void *arg) {
+  uint32_t last = Profiler.now();
+  for (;;) {
+    // Loop period, including the delay: shows the jitter of the task
+    uint32_t start = Profiler.now();
+    Profiler.record(PROF_CONTROL_PERIOD, start - last);
+    last = start;
+
+    controlLoop();
+    // Small delay to prevent CPU hogging
+    vTaskDelay(pdMS_TO_TICKS(1));
+  }
+}
+
+void loop() {
+  // All work runs in the pinned control and motion tasks
+  vTaskDelete(NULL);
 }
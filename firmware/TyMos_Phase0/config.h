@@ -6,31 +6,157 @@
 // I2C Configuration
 #define I2C_SDA_PIN 21
 #define I2C_SCL_PIN 22
-#define I2C_CLOCK_SPEED 400000
+#define I2C_CLOCK_SPEED 1000000      // Boot clock (Fast-mode Plus)
+#define I2C_CLOCK_MIN_SPEED 100000   // Lowest step when backing off
+#define I2C_DIRECT_CLOCK_SPEED 400000 // Libraries using Wire directly
+
+// Logger Configuration
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_WARNING 1
+#define LOG_LEVEL_INFO 2
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO // Lower levels compile out info()/warning()
+#endif
+#define LOG_RING_SIZE 64     // Records waiting to be printed (power of two)
+#define LOG_MAX_ARGS 8       // Arguments kept per record
+#define LOG_STRING_BYTES 48  // %s text kept per record (truncated beyond)
+#ifdef ARDUINO_ARCH_ESP32
+#define LOG_USE_TASK 1       // Format and print from a low-priority task
+#else
+#define LOG_USE_TASK 0       // Host builds: print right away
+#endif
+#define LOG_TASK_PRIORITY 1
+#define LOG_TASK_STACK 3072
+#define LOG_DRAIN_INTERVAL_MS 10
+
+// Trace Configuration (see utils_trace.h)
+#define TRACE_ENABLED 1 // 0 compiles every TRACE_EVENT hook out
+#ifndef TRACE_BUFFER_EVENTS
+#define TRACE_BUFFER_EVENTS 1024 // Newest events kept, 12 bytes each
+#endif
+
+// Loop Profiler Configuration (see utils_profiler.h)
+#define PROFILER_ENABLED 1 // 0 compiles the stage timing out
+#define PROFILER_REPORT_INTERVAL_MS 600000 // Log histograms (0 = on demand)
+#define PROFILER_SLOW_STAGE_US 20000       // Warn on a new worst case above
+
+// Microbenchmarks (see utils_bench.h)
+#ifndef BENCH_ENABLED
+#define BENCH_ENABLED 0 // 1 adds the 'b' serial command
+#endif
+#define BENCH_TARGET_ITERATIONS 2000 // Operations per kernel run on target
+
+// I2C Bus Manager Configuration
+#define I2C_BUS_QUEUE_DEPTH 16    // Transactions queued or awaiting pickup
+#define I2C_BUS_MAX_TX 65         // Register + 16 PCA9685 channels * 4 bytes
+#define I2C_BUS_MAX_RX 8          // DS3231 time registers (7) + spare
+#define I2C_BUS_SUBMIT_WAIT_MS 5  // Wait for a free slot before failing
+#define I2C_BUS_STATS_WINDOW_MS 10000 // Saturation check interval
+#define I2C_BUS_SATURATION_PCT 70 // Warn above this bus utilization
+#define I2C_BUS_TIMEOUT_MS 5      // Wire timeout: how fast a stuck bus fails
+#define I2C_BUS_RETRIES 2         // Extra attempts of a failed transaction
+#define I2C_BUS_BACKOFF_ERRORS 3  // Failures within the window that step
+#define I2C_BUS_BACKOFF_WINDOW_MS 1000 // the clock down
+#define I2C_BUS_MAX_DEVICES 4     // Addresses with their own error counts
+#ifdef ARDUINO_ARCH_ESP32
+#define I2C_BUS_USE_TASK 1        // Serve the queue from a FreeRTOS task
+#else
+#define I2C_BUS_USE_TASK 0        // Host builds: run transactions on submit
+#endif
+#define I2C_BUS_TASK_PRIORITY 3
+#define I2C_BUS_TASK_STACK 3072
+
+// Task Configuration (ESP32: motion on core 1, control/network on core 0)
+#ifdef ARDUINO_ARCH_ESP32
+#define MOTION_USE_TASK 1
+#else
+#define MOTION_USE_TASK 0 // Host builds step the motion side themselves
+#endif
+#define MOTION_TASK_CORE 1
+#define MOTION_TASK_PRIORITY 5
+#define MOTION_TASK_STACK 4096
+#define MOTION_TASK_PERIOD_MS 1
+#define MOTION_COMMAND_QUEUE 8 // Display commands in flight (power of two)
+#define CONTROL_TASK_CORE 0
+#define CONTROL_TASK_PRIORITY 2
+#define CONTROL_TASK_STACK 8192
+
+// WiFi / NTP Configuration
+#define WIFI_CONNECT_TIMEOUT_MS 15000 // Give up on one attempt after this
+#define WIFI_BACKOFF_MIN_MS 2000      // First retry delay, doubled per failure
+#define WIFI_BACKOFF_MAX_MS 300000    // Retry at least every 5 minutes
+#define NTP_SYNC_INTERVAL_MS (12UL * 60UL * 60UL * 1000UL) // 12 hours
 
 // PCA9685 Configuration
 #define PCA9685_ADDR_HOURS 0x40
 #define PCA9685_ADDR_MINUTES 0x41
 #define PCA9685_PWM_FREQ 50
+#define PCA9685_NUM_BOARDS 2
+#define PCA9685_BURST_MAX_CHANNELS 16 // 1 + 16*4 bytes fits the ESP32 Wire buffer
+#define PCA9685_BURST_MAX_GAP 1 // Unchanged channels rewritten to join two runs
+#define PCA9685_PHASE_STEP 256  // ON offset between channels (counts, 0 = off)
+#define PCA9685_FRAME_RETRIES 3 // Re-sends of a burst the bus gave up on
 
 // Servo Configuration
 #define SERVO_MIN_PULSE_US 500
 #define SERVO_MAX_PULSE_US 2500
-#define SERVO_STAGGER_DELAY_MS 20
-#define SERVO_IDLE_TIMEOUT_MS 500
+#define SERVO_PULSE_LIMIT_MIN_US 400  // Accepted range for per-channel
+#define SERVO_PULSE_LIMIT_MAX_US 2600 // calibration endpoints
+#define SERVO_STAGGER_DELAY_MS 20 // Default, user setting (Settings)
+#define SERVO_IDLE_TIMEOUT_MS 500 // Default hold time after the last move
+#define SERVO_HOLD_SEGMENT7_MS 2000 // Segment 7 (2 and 6 swing past it)
+#define SERVO_HOLD_FOREVER 0xFFFFFFFFUL // Hold policy: never detach
+#define SERVO_HOMING_STEP_MS 300 // Quick homing: one segment reaches rest
+
+// Power Budget (supply current model, see motion_power.h)
+#define POWER_SUPPLY_MA 3000        // 5 V / 3 A supply
+#define POWER_MARGIN_MA 400         // Kept free for model error
+#define POWER_BASE_MA 300           // ESP32 (WiFi TX peaks) and PCA9685s
+#define SERVO_CURRENT_START_MA 500  // SG90 accelerating from rest
+#define SERVO_START_WINDOW_MS 60    // How long the start current lasts
+#define SERVO_CURRENT_RUN_MA 180    // SG90 moving a segment
+#define SERVO_CURRENT_HOLD_MA 10    // SG90 powered, holding position
+
+// RTC Configuration
+#define RTC_RESYNC_INTERVAL_MS 600000   // Re-anchor the software clock (10 min)
+#define RTC_EDGE_POLL_INTERVAL_MS 5     // Chip reads while finding the edge
+#define RTC_EDGE_GUARD_MS 50            // Polling starts this early (drift)
+#define RTC_EDGE_SEARCH_TIMEOUT_MS 2500 // Give up if seconds do not advance
+#define RTC_I2C_MAX_CLOCK 400000        // DS3231: Fast-mode at most
+
+// Settings Configuration (defaults of the persisted user settings)
+#define NIGHT_START_MINUTE (22 * 60) // Night mode 22:00 - 07:00
+#define NIGHT_END_MINUTE (7 * 60)
+#define SETTINGS_STAGGER_MAX_MS 200
+#define SETTINGS_SAVE_DELAY_MS 3000 // Coalesce changes into one NVS write
+
+// Display Configuration
+#define DISPLAY_POLL_INTERVAL_MS 20 // Software clock checks
+#define DISPLAY_LEAD_MARGIN_MS 20   // Extra lead for bus and loop jitter
+#define DISPLAY_MAX_LEAD_MS 20000   // Never start a minute change earlier
 
 // Motion Configuration - Speed Profiles
-// All profiles use 5° steps with different delays
-#define SPEED_STEP_DEGREES 5        // Degrees per step (same for all profiles)
-#define SPEED_FAST_DELAY_MS 10      // Delay between steps - FAST (quick)
-#define SPEED_NORMAL_DELAY_MS 50    // Delay between steps - NORMAL (standard)
-#define SPEED_NIGHT_DELAY_MS 100    // Delay between steps - NIGHT (silent)
+// Time-parameterized moves, evaluated every PWM frame at 12-bit resolution
+// Velocity in deg/s, acceleration in deg/s^2, jerk in deg/s^3
+// (jerk 0 = trapezoidal, otherwise S-curve)
+#define MOTION_FRAME_INTERVAL_MS 20 // One 50Hz PWM period
+
+#define SPEED_FAST_MAX_VELOCITY 600     // FAST (quick)
+#define SPEED_FAST_ACCELERATION 20000
+#define SPEED_FAST_JERK 0
+#define SPEED_NORMAL_MAX_VELOCITY 180   // NORMAL (standard)
+#define SPEED_NORMAL_ACCELERATION 1500
+#define SPEED_NORMAL_JERK 25000
+#define SPEED_NIGHT_MAX_VELOCITY 75     // NIGHT (silent)
+#define SPEED_NIGHT_ACCELERATION 400
+#define SPEED_NIGHT_JERK 4000
 
 // Speed Profile Enum
 enum SpeedProfile {
-  SPEED_FAST,    // 5° every 10ms (fast)
-  SPEED_NORMAL,  // 5° every 50ms (standard)
-  SPEED_NIGHT    // 5° every 100ms (silent)
+  SPEED_FAST,    // Trapezoidal, up to 600°/s
+  SPEED_NORMAL,  // S-curve, up to 180°/s
+  SPEED_NIGHT,   // S-curve, up to 75°/s (silent)
+  SPEED_PROFILE_COUNT
 };
 
 // Segment Angles (Default)
@@ -1,71 +1,127 @@
 #include "core_display_manager.h"
 #include "utils_logger.h"
 
-CoreDisplayManager::CoreDisplayManager(RTCDriver *rtc, MotionEngine *engine) {
+CoreDisplayManager::CoreDisplayManager(RTCDriver *rtc, MotionTask *motion) {
   _rtc = rtc;
-  _engine = engine;
-  _currentDO = -1;
-  _currentUO = -1;
-  _currentDM = -1;
-  _currentUM = -1;
+  _motion = motion;
+  for (int d = 0; d < 4; d++) {
+    _current.digits[d] = -1;
+  }
+  _current.separator = false;
   _lastUpdateCheck = 0;
+  _leadArmed = false;
+  _leadMinute = -1;
+  _leadStartAt = 0;
 }
 
-void CoreDisplayManager::begin() {
+void CoreDisplayManager::begin(const DisplayState &pose) {
   Logger.info("Display Manager initializing...");
 
-  // After resetSequence(), display shows 88:88 (all segments active)
   // Initialize current state to match physical display state
-  _currentDO = 8;
-  _currentUO = 8;
-  _currentDM = 8;
-  _currentUM = 8;
+  _current = pose;
 
-  // Now update from 88:88 to actual time
+  // Now update to actual time (only the digits that differ move, nothing
+  // after a warm boot within the same minute)
   DateTime now = _rtc->now();
   Logger.info("Ora corrente RTC: %02d:%02d", now.hour(), now.minute());
-  showTime(now.hour(), now.minute(), true);
-
-  // Separator is already active from resetSequence, but ensure it
-  _engine->setSeparator(true);
+  showTime(now.hour(), now.minute());
 }
 
 void CoreDisplayManager::update() {
-  // Check every second? Or 500ms?
-  if (millis() - _lastUpdateCheck > 1000) {
-    DateTime now = _rtc->now();
-    showTime(now.hour(), now.minute());
-    _lastUpdateCheck = millis();
+  uint32_t nowMs = millis();
+
+  // Anticipated change is due: start it without waiting for the RTC
+  if (_leadArmed && (int32_t)(nowMs - _leadStartAt) >= 0) {
+    _leadArmed = false;
+    _showMinute(_leadMinute);
+  }
+
+  if (nowMs - _lastUpdateCheck < DISPLAY_POLL_INTERVAL_MS)
+    return;
+  _lastUpdateCheck = nowMs;
+
+  DateTime now = _rtc->now();
+
+  int minute = now.hour() * 60 + now.minute();
+  int shown = displayedMinute();
+  if (shown == (minute + 1) % 1440)
+    return; // Already moving to (or showing) the next minute
+  if (shown != minute) {
+    // Missed boundary or clock jump: catch up right away
+    _leadArmed = false;
+    _showMinute(minute);
+    return;
   }
+
+  _planLead(now, nowMs);
 }
 
-void CoreDisplayManager::showTime(int hours, int minutes, bool forceUpdates) {
-  int nextDO = hours / 10;
-  int nextUO = hours % 10;
-  int nextDM = minutes / 10;
-  int nextUM = minutes % 10;
-
-  // Update Decimals Hours (only if changed or forced)
-  if (forceUpdates || nextDO != _currentDO) {
-    _engine->updateDigit(DIGIT_DO, _currentDO, nextDO);
-    _currentDO = nextDO;
+void CoreDisplayManager::_planLead(const DateTime &now, uint32_t nowMs) {
+  // Time left until hh:mm:00
+  uint32_t toBoundary =
+      (59 - now.second()) * 1000UL + (1000 - _rtc->millisIntoSecond());
+
+  if (toBoundary > DISPLAY_MAX_LEAD_MS + DISPLAY_POLL_INTERVAL_MS) {
+    _leadArmed = false;
+    return;
   }
 
-  // Update Units Hours
-  if (forceUpdates || nextUO != _currentUO) {
-    _engine->updateDigit(DIGIT_UO, _currentUO, nextUO);
-    _currentUO = nextUO;
+  int nextMinute = (now.hour() * 60 + now.minute() + 1) % 1440;
+  DisplayState next = _current;
+  next.digits[DIGIT_DO] = nextMinute / 600;
+  next.digits[DIGIT_UO] = (nextMinute / 60) % 10;
+  next.digits[DIGIT_DM] = (nextMinute % 60) / 10;
+  next.digits[DIGIT_UM] = nextMinute % 10;
+
+  uint32_t lead = _motion->estimateDisplayMs(_current, next) +
+                  DISPLAY_LEAD_MARGIN_MS;
+  if (lead > DISPLAY_MAX_LEAD_MS)
+    lead = DISPLAY_MAX_LEAD_MS;
+
+  // Arm once the start falls within the next poll; re-estimated on every
+  // poll so a speed change before the start is taken into account
+  if (toBoundary > lead + DISPLAY_POLL_INTERVAL_MS) {
+    _leadArmed = false;
+    return;
   }
+  _leadArmed = true;
+  _leadMinute = nextMinute;
+  _leadStartAt = nowMs + (toBoundary > lead ? toBoundary - lead : 0);
+}
 
-  // Update Decimals Minutes
-  if (forceUpdates || nextDM != _currentDM) {
-    _engine->updateDigit(DIGIT_DM, _currentDM, nextDM);
-    _currentDM = nextDM;
+int CoreDisplayManager::displayedMinute() {
+  for (int d = 0; d < 4; d++) {
+    if (_current.digits[d] < 0 || _current.digits[d] > 9)
+      return -1;
   }
+  int hours = _current.digits[DIGIT_DO] * 10 + _current.digits[DIGIT_UO];
+  int minutes = _current.digits[DIGIT_DM] * 10 + _current.digits[DIGIT_UM];
+  return hours * 60 + minutes;
+}
 
-  // Update Units Minutes
-  if (forceUpdates || nextUM != _currentUM) {
-    _engine->updateDigit(DIGIT_UM, _currentUM, nextUM);
-    _currentUM = nextUM;
+void CoreDisplayManager::_showMinute(int minuteOfDay) {
+  showTime(minuteOfDay / 60, minuteOfDay % 60);
+}
+
+void CoreDisplayManager::showTime(int hours, int minutes, bool forceUpdates) {
+  DisplayState next = _current;
+  next.digits[DIGIT_DO] = hours / 10;
+  next.digits[DIGIT_UO] = hours % 10;
+  next.digits[DIGIT_DM] = minutes / 10;
+  next.digits[DIGIT_UM] = minutes % 10;
+  next.separator = true; // Off only after homing
+
+  // Only changed digits move, even when forced
+  bool changed = next.separator != _current.separator;
+  for (int d = 0; d < 4; d++) {
+    if (next.digits[d] != _current.digits[d])
+      changed = true;
   }
+  if (!changed && !forceUpdates)
+    return;
+
+  // A full queue is retried by the next update() (the minute still differs)
+  if (!_motion->postDisplay(_current, next))
+    return;
+  _current = next;
 }
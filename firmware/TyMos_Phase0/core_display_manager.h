@@ -2,33 +2,46 @@
 #define CORE_DISPLAY_MANAGER_H
 
 #include "hw_rtc.h"
-#include "motion_engine.h"
+#include "motion_task.h"
 #include <Arduino.h>
 
 class CoreDisplayManager {
 public:
-  CoreDisplayManager(RTCDriver *rtc, MotionEngine *engine);
+  CoreDisplayManager(RTCDriver *rtc, MotionTask *motion);
 
-  // Initial display setup (force update)
-  void begin();
+  // Initial display setup from the pose the servos are in (restored from
+  // PoseStore or homed), then move to the current time
+  void begin(const DisplayState &pose);
 
-  // Check time and update display if needed
+  // Check time and update display if needed. The next minute's change is
+  // started ahead of time, by its expected duration, so that the last
+  // segment settles at hh:mm:00.
   void update();
 
   // Force specific time display
+  // The whole HH:MM change is composed into one concurrent transition
   void showTime(int hours, int minutes, bool forceUpdates = false);
 
+  // Minute of day shown on the display (or being moved to once posted),
+  // -1 if unknown
+  int displayedMinute();
+
 private:
   RTCDriver *_rtc;
-  MotionEngine *_engine;
+  MotionTask *_motion; // Display changes are posted to the motion task
 
-  // Track currently displayed digits to minimize movements
-  int _currentDO;
-  int _currentUO;
-  int _currentDM;
-  int _currentUM;
+  // Track currently displayed glyphs to minimize movements
+  DisplayState _current;
 
   uint32_t _lastUpdateCheck;
+
+  // Anticipated change of the next minute, started at _leadStartAt
+  bool _leadArmed;
+  int _leadMinute; // Minute of day to show
+  uint32_t _leadStartAt;
+
+  void _showMinute(int minuteOfDay);
+  void _planLead(const DateTime &now, uint32_t nowMs);
 };
 
 #endif // CORE_DISPLAY_MANAGER_H
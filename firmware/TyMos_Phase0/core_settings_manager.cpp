@@ -1,33 +1,216 @@
 #include "core_settings_manager.h"
+#include "motion_calibration.h"
+#include "motion_profile.h"
 #include "utils_logger.h"
+#include <Preferences.h>
 
 // Global instance
 CoreSettingsManager Settings;
 
-CoreSettingsManager::CoreSettingsManager() { _currentSpeed = SPEED_NORMAL; }
+// NVS layout. Fields are only ever appended: a record from an older
+// version is shorter and the new fields keep their defaults, a record from
+// a newer version is read up to the fields this one knows (as long as it
+// fits SETTINGS_NVS_MAX_BYTES).
+static const char *SETTINGS_NVS_NAMESPACE = "tymos-set";
+static const char *SETTINGS_NVS_KEY = "settings";
+static const uint16_t SETTINGS_LAYOUT_VERSION = 1;
+#define SETTINGS_NVS_MAX_BYTES 64
+
+struct StoredSettings {
+  uint16_t version;
+  uint8_t speed; // Day speed (SpeedProfile)
+  uint8_t reserved;
+  uint16_t nightStart; // Minutes of the day
+  uint16_t nightEnd;
+  uint16_t staggerMs;
+};
+
+CoreSettingsManager::CoreSettingsManager() {
+  _speed = SPEED_NORMAL;
+  _nightMode = false;
+  _nightStart = NIGHT_START_MINUTE;
+  _nightEnd = NIGHT_END_MINUTE;
+  _staggerMs = SERVO_STAGGER_DELAY_MS;
+  _dirty = false;
+  _calibrationDirty = false;
+  _dirtySince = 0;
+}
+
+void CoreSettingsManager::begin() {
+  Preferences prefs;
+  StoredSettings stored;
+
+  if (!prefs.begin(SETTINGS_NVS_NAMESPACE, true)) {
+    Logger.info("Settings: nothing stored, using defaults");
+    return;
+  }
+  // Defaults first, so fields missing from an older record keep them
+  stored.version = 0;
+  stored.speed = _speed;
+  stored.nightStart = _nightStart;
+  stored.nightEnd = _nightEnd;
+  stored.staggerMs = _staggerMs;
+  // getBytes() refuses a blob larger than the buffer: read the whole
+  // record, then keep the fields this version knows
+  uint8_t raw[SETTINGS_NVS_MAX_BYTES];
+  size_t len = prefs.getBytesLength(SETTINGS_NVS_KEY);
+  if (len > sizeof(raw)) {
+    Logger.warning("Settings: %u-byte record too large, using defaults",
+                   (unsigned)len);
+    len = 0;
+  } else if (len) {
+    len = prefs.getBytes(SETTINGS_NVS_KEY, raw, len);
+  }
+  prefs.end();
+  memcpy(&stored, raw, len < sizeof(stored) ? len : sizeof(stored));
+
+  if (len < sizeof(stored.version) || stored.version == 0) {
+    Logger.info("Settings: nothing stored, using defaults");
+    return;
+  }
+
+  int invalid = 0;
+  if (stored.speed < SPEED_PROFILE_COUNT)
+    _speed = (SpeedProfile)stored.speed;
+  else
+    invalid++;
+  if (stored.nightStart < 1440 && stored.nightEnd < 1440) {
+    _nightStart = stored.nightStart;
+    _nightEnd = stored.nightEnd;
+  } else {
+    invalid++;
+  }
+  if (stored.staggerMs <= SETTINGS_STAGGER_MAX_MS)
+    _staggerMs = stored.staggerMs;
+  else
+    invalid++;
+
+  Logger.info("Settings loaded (layout v%d, %d invalid reset): speed %s, "
+              "night %02d:%02d-%02d:%02d, stagger %d ms",
+              stored.version, invalid, MotionTrajectory::getProfile(_speed).name,
+              _nightStart / 60, _nightStart % 60, _nightEnd / 60,
+              _nightEnd % 60, _staggerMs);
+}
+
+void CoreSettingsManager::_markDirty() {
+  if (!_dirty && !_calibrationDirty)
+    _dirtySince = millis();
+}
+
+void CoreSettingsManager::update() {
+  if ((_dirty || _calibrationDirty) &&
+      millis() - _dirtySince >= SETTINGS_SAVE_DELAY_MS)
+    save();
+}
+
+bool CoreSettingsManager::save() {
+  bool ok = true;
+
+  if (_calibrationDirty) {
+    _calibrationDirty = false;
+    ok &= Calibration.save();
+  }
+
+  if (_dirty) {
+    _dirty = false;
+
+    StoredSettings stored;
+    memset(&stored, 0, sizeof(stored));
+    stored.version = SETTINGS_LAYOUT_VERSION;
+    stored.speed = _speed;
+    stored.nightStart = _nightStart;
+    stored.nightEnd = _nightEnd;
+    stored.staggerMs = _staggerMs;
+
+    Preferences prefs;
+    if (!prefs.begin(SETTINGS_NVS_NAMESPACE, false)) {
+      Logger.error("Settings: cannot open NVS");
+      return false;
+    }
+    bool written = prefs.putBytes(SETTINGS_NVS_KEY, &stored,
+                                  sizeof(stored)) == sizeof(stored);
+    prefs.end();
+
+    if (!written) {
+      Logger.error("Settings: NVS write failed");
+      ok = false;
+    }
+  }
+  return ok;
+}
 
 void CoreSettingsManager::setSpeed(SpeedProfile speed) {
-  _currentSpeed = speed;
-  const char *speedName;
-  switch (speed) {
-    case SPEED_FAST:
-      speedName = "FAST";
-      break;
-    case SPEED_NORMAL:
-      speedName = "NORMAL";
-      break;
-    case SPEED_NIGHT:
-    default:
-      speedName = "NIGHT";
-      break;
+  if (speed >= SPEED_PROFILE_COUNT)
+    return;
+  if (speed != _speed) {
+    _markDirty();
+    _dirty = true;
   }
-  Logger.info("Speed set to: %s", speedName);
+  _speed = speed;
+  Logger.info("Speed set to: %s", MotionTrajectory::getProfile(speed).name);
 }
 
-SpeedProfile CoreSettingsManager::getSpeed() { return _currentSpeed; }
+SpeedProfile CoreSettingsManager::getSpeed() {
+  return _nightMode ? SPEED_NIGHT : _speed;
+}
 
-bool CoreSettingsManager::isNightMode() { return _currentSpeed == SPEED_NIGHT; }
+bool CoreSettingsManager::isNightMode() { return _nightMode; }
 
 void CoreSettingsManager::setNightMode(bool enabled) {
-  setSpeed(enabled ? SPEED_NIGHT : SPEED_NORMAL);
+  _nightMode = enabled;
+  Logger.info("Speed set to: %s",
+              MotionTrajectory::getProfile(getSpeed()).name);
+}
+
+bool CoreSettingsManager::setNightWindow(uint16_t startMinute,
+                                         uint16_t endMinute) {
+  if (startMinute >= 1440 || endMinute >= 1440)
+    return false;
+  if (startMinute != _nightStart || endMinute != _nightEnd) {
+    _markDirty();
+    _dirty = true;
+  }
+  _nightStart = startMinute;
+  _nightEnd = endMinute;
+  return true;
+}
+
+uint16_t CoreSettingsManager::getNightStart() { return _nightStart; }
+
+uint16_t CoreSettingsManager::getNightEnd() { return _nightEnd; }
+
+bool CoreSettingsManager::isNightTime(int hour, int minute) {
+  int m = hour * 60 + minute;
+  if (_nightStart == _nightEnd)
+    return false;
+  if (_nightStart < _nightEnd)
+    return m >= _nightStart && m < _nightEnd;
+  return m >= _nightStart || m < _nightEnd; // Wraps midnight
+}
+
+bool CoreSettingsManager::setStaggerMs(uint16_t ms) {
+  if (ms > SETTINGS_STAGGER_MAX_MS)
+    return false;
+  if (ms != _staggerMs) {
+    _markDirty();
+    _dirty = true;
+  }
+  _staggerMs = ms;
+  return true;
+}
+
+uint16_t CoreSettingsManager::getStaggerMs() { return _staggerMs; }
+
+bool CoreSettingsManager::setAngleOverride(uint8_t boardAddr, uint8_t channel,
+                                           int16_t active, int16_t rest) {
+  ServoCalibration cal = Calibration.get(boardAddr, channel);
+  if (cal.active == active && cal.rest == rest)
+    return true;
+  cal.active = active;
+  cal.rest = rest;
+  if (!Calibration.set(boardAddr, channel, cal))
+    return false;
+  _markDirty();
+  _calibrationDirty = true;
+  return true;
 }
@@ -4,20 +4,62 @@
 #include "config.h"
 #include <Arduino.h>
 
+// User settings, persisted in NVS. Getters read the RAM copy (safe from
+// the motion core); setters only mark it dirty and update() writes it
+// back once SETTINGS_SAVE_DELAY_MS have passed since the first unsaved
+// change, so a burst of changes (a UI slider) costs one flash write.
 class CoreSettingsManager {
 public:
   CoreSettingsManager();
 
-  // Speed management
+  // Load from NVS, defaults for anything missing or invalid. Call after
+  // Calibration.begin() (angle overrides live in the calibration).
+  void begin();
+
+  // Call from the control loop: flushes coalesced writes when due
+  void update();
+
+  // Write pending changes now (e.g. before a reboot)
+  bool save();
+
+  // Speed management. setSpeed() sets the persisted day speed, getSpeed()
+  // returns the active profile (NIGHT while night mode is on).
   void setSpeed(SpeedProfile speed);
   SpeedProfile getSpeed();
 
-  // Night mode helper
+  // Night mode helper (runtime only, follows the night window)
   bool isNightMode();
   void setNightMode(bool enabled);
 
+  // Night window in minutes of the day, may wrap midnight. start == end
+  // disables automatic night mode.
+  bool setNightWindow(uint16_t startMinute, uint16_t endMinute);
+  uint16_t getNightStart();
+  uint16_t getNightEnd();
+  bool isNightTime(int hour, int minute);
+
+  // Delay between the starts of staggered segment moves
+  bool setStaggerMs(uint16_t ms);
+  uint16_t getStaggerMs();
+
+  // Per-channel active/rest angle overrides (CAL_ANGLE_DEFAULT = segment
+  // default), kept in the servo calibration and saved with the settings.
+  // False if rejected by MotionCalibration::set().
+  bool setAngleOverride(uint8_t boardAddr, uint8_t channel, int16_t active,
+                        int16_t rest);
+
 private:
-  SpeedProfile _currentSpeed;
+  SpeedProfile _speed; // Day speed (persisted)
+  bool _nightMode;
+  uint16_t _nightStart;
+  uint16_t _nightEnd;
+  uint16_t _staggerMs;
+
+  bool _dirty;
+  bool _calibrationDirty;
+  uint32_t _dirtySince;
+
+  void _markDirty();
 };
 
 // Global settings instance
@@ -0,0 +1,530 @@
+#include "hw_i2c_bus.h"
+#include "utils_logger.h"
+#include "utils_trace.h"
+
+HwI2CBus I2CBus;
+
+static const char *PRIORITY_NAMES[I2C_PRIO_COUNT] = {"servo", "rtc", "temp"};
+
+// Backoff ladder: Fast-mode Plus, Fast-mode, Standard-mode
+static const uint32_t CLOCK_STEPS[] = {1000000, 400000, 100000};
+
+// Wire (ESP32 core) results
+#define WIRE_NACK_ADDRESS 2
+#define WIRE_NACK_DATA 3
+#define WIRE_ERROR 4
+#define WIRE_TIMEOUT 5
+
+HwI2CBus::HwI2CBus() {
+  _nextSequence = 0;
+  _started = false;
+  _clock = I2C_CLOCK_SPEED;
+  _clockConfirmed = false;
+  _wireClock = 0;
+  _errorWindowStart = 0;
+  _windowErrors = 0;
+  _lastRecoveryLog = 0;
+  _deviceCount = 0;
+  for (int i = 0; i < I2C_BUS_QUEUE_DEPTH; i++) {
+    _slots[i].state = I2C_TXN_FREE;
+  }
+#if I2C_BUS_USE_TASK
+  _task = NULL;
+  _busMutex = NULL;
+  _queueMux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+  resetStats();
+}
+
+void HwI2CBus::begin() {
+  if (_started)
+    return;
+  _started = true;
+  resetStats();
+  Wire.setTimeOut(I2C_BUS_TIMEOUT_MS);
+  _applyClock(_clock);
+
+#if I2C_BUS_USE_TASK
+  _busMutex = xSemaphoreCreateMutex();
+  xTaskCreate(_taskMain, "i2c_bus", I2C_BUS_TASK_STACK, this,
+              I2C_BUS_TASK_PRIORITY, &_task);
+  Logger.info("I2C bus manager started (task, %d slots)", I2C_BUS_QUEUE_DEPTH);
+#else
+  Logger.info("I2C bus manager started (inline, %d slots)",
+              I2C_BUS_QUEUE_DEPTH);
+#endif
+}
+
+#if I2C_BUS_USE_TASK
+void HwI2CBus::_taskMain(void *arg) {
+  HwI2CBus *bus = (HwI2CBus *)arg;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    bus->_service();
+  }
+}
+#endif
+
+void HwI2CBus::_enterQueue() {
+#if I2C_BUS_USE_TASK
+  portENTER_CRITICAL(&_queueMux);
+#endif
+}
+
+void HwI2CBus::_exitQueue() {
+#if I2C_BUS_USE_TASK
+  portEXIT_CRITICAL(&_queueMux);
+#endif
+}
+
+void HwI2CBus::_takeBus() {
+#if I2C_BUS_USE_TASK
+  if (_busMutex)
+    xSemaphoreTake(_busMutex, portMAX_DELAY);
+#endif
+}
+
+void HwI2CBus::_giveBus() {
+#if I2C_BUS_USE_TASK
+  if (_busMutex)
+    xSemaphoreGive(_busMutex);
+#endif
+}
+
+void HwI2CBus::lock() {
+  _takeBus();
+  if (_started)
+    _applyClock(_clock < I2C_DIRECT_CLOCK_SPEED ? _clock
+                                                : I2C_DIRECT_CLOCK_SPEED);
+}
+
+void HwI2CBus::unlock() {
+  // The library may have re-initialized Wire: set the clock again on the
+  // next transaction
+  _wireClock = 0;
+  _giveBus();
+}
+
+void HwI2CBus::setDeviceMaxClock(uint8_t address, uint32_t maxClock) {
+  _takeBus();
+  int d = _deviceIndex(address);
+  if (d >= 0)
+    _deviceMaxClock[d] = maxClock;
+  _giveBus();
+}
+
+int HwI2CBus::_deviceIndex(uint8_t address) {
+  for (int d = 0; d < _deviceCount; d++) {
+    if (_deviceAddress[d] == address)
+      return d;
+  }
+  if (_deviceCount >= I2C_BUS_MAX_DEVICES)
+    return -1;
+  int d = _deviceCount;
+  _deviceAddress[d] = address;
+  _deviceMaxClock[d] = 0;
+  _devicePresent[d] = false;
+  _enterQueue();
+  _stats.device[d].address = address;
+  _stats.deviceCount = ++_deviceCount;
+  _exitQueue();
+  return d;
+}
+
+void HwI2CBus::_applyClock(uint32_t clock) {
+  if (clock == _wireClock)
+    return;
+  Wire.setClock(clock);
+  _wireClock = clock;
+}
+
+int HwI2CBus::_claimSlot() {
+  for (int i = 0; i < I2C_BUS_QUEUE_DEPTH; i++) {
+    if (_slots[i].state == I2C_TXN_FREE) {
+      _slots[i].state = I2C_TXN_QUEUED;
+      return i;
+    }
+  }
+  return -1;
+}
+
+int HwI2CBus::submit(uint8_t address, I2CPriority priority,
+                     const uint8_t *tx, uint8_t txLen, uint8_t rxLen,
+                     I2CCallback onComplete, void *context, uint32_t tag) {
+  if (txLen > I2C_BUS_MAX_TX || rxLen > I2C_BUS_MAX_RX ||
+      priority >= I2C_PRIO_COUNT) {
+    Logger.error("I2C bus: invalid transaction for 0x%X", address);
+    return -1;
+  }
+
+  // Finished transactions hold their slot until their callback has run
+  uint32_t waitStart = millis();
+  int handle;
+  for (;;) {
+    _enterQueue();
+    handle = _claimSlot();
+    _exitQueue();
+    if (handle >= 0)
+      break;
+
+    // Reclaim slots of finished callbacks, only from the task that owns
+    // them (the one submitting with callbacks)
+    if (onComplete)
+      _dispatch();
+    _enterQueue();
+    handle = _claimSlot();
+    _exitQueue();
+    if (handle >= 0 || millis() - waitStart >= I2C_BUS_SUBMIT_WAIT_MS)
+      break;
+    delay(1);
+  }
+  if (handle < 0) {
+    _enterQueue();
+    _stats.queueFull++;
+    _exitQueue();
+    return -1;
+  }
+
+  I2CTransaction &t = _slots[handle];
+  t.priority = priority;
+  t.address = address;
+  t.txLen = txLen;
+  t.rxLen = rxLen;
+  t.result = 0;
+  if (txLen)
+    memcpy(t.tx, tx, txLen);
+  t.tag = tag;
+  t.onComplete = onComplete;
+  t.context = context;
+  t.submittedUs = micros();
+
+  _enterQueue();
+  t.sequence = _nextSequence++;
+  uint8_t queued = 0;
+  for (int i = 0; i < I2C_BUS_QUEUE_DEPTH; i++) {
+    uint8_t state = _slots[i].state;
+    if (state == I2C_TXN_QUEUED || state == I2C_TXN_RUNNING)
+      queued++;
+  }
+  if (queued > _stats.maxQueued)
+    _stats.maxQueued = queued;
+  _exitQueue();
+
+#if I2C_BUS_USE_TASK
+  xTaskNotifyGive(_task);
+#else
+  _service();
+  if (onComplete)
+    _dispatch();
+#endif
+  return handle;
+}
+
+bool HwI2CBus::isDone(int handle) {
+  if (handle < 0 || handle >= I2C_BUS_QUEUE_DEPTH)
+    return true;
+  return _slots[handle].state == I2C_TXN_DONE;
+}
+
+const I2CTransaction &HwI2CBus::get(int handle) { return _slots[handle]; }
+
+void HwI2CBus::release(int handle) {
+  if (handle < 0 || handle >= I2C_BUS_QUEUE_DEPTH)
+    return;
+  _enterQueue();
+  if (_slots[handle].state == I2C_TXN_DONE)
+    _slots[handle].state = I2C_TXN_FREE;
+  _exitQueue();
+}
+
+uint8_t HwI2CBus::transfer(uint8_t address, I2CPriority priority,
+                           const uint8_t *tx, uint8_t txLen, uint8_t *rx,
+                           uint8_t rxLen) {
+  int handle = submit(address, priority, tx, txLen, rxLen);
+  if (handle < 0)
+    return 4; // Same code as Wire's "other error"
+
+  while (!isDone(handle)) {
+    delay(1);
+  }
+
+  const I2CTransaction &t = _slots[handle];
+  uint8_t result = t.result;
+  if (result == 0 && rx && rxLen)
+    memcpy(rx, t.rx, rxLen);
+  release(handle);
+  return result;
+}
+
+int HwI2CBus::_nextQueued() {
+  // Highest priority first, oldest first within a priority
+  int best = -1;
+  _enterQueue();
+  for (int i = 0; i < I2C_BUS_QUEUE_DEPTH; i++) {
+    const I2CTransaction &t = _slots[i];
+    if (t.state != I2C_TXN_QUEUED)
+      continue;
+    if (best < 0 || t.priority < _slots[best].priority ||
+        (t.priority == _slots[best].priority &&
+         (int32_t)(t.sequence - _slots[best].sequence) < 0))
+      best = i;
+  }
+  if (best >= 0)
+    _slots[best].state = I2C_TXN_RUNNING;
+  _exitQueue();
+  return best;
+}
+
+void HwI2CBus::_service() {
+  int i;
+  while ((i = _nextQueued()) >= 0) {
+    _takeBus();
+    _execute(_slots[i]);
+    _giveBus();
+  }
+}
+
+uint8_t HwI2CBus::_attempt(I2CTransaction &t) {
+  Wire.beginTransmission(t.address);
+  if (t.txLen)
+    Wire.write(t.tx, t.txLen);
+  uint8_t result = Wire.endTransmission(t.rxLen == 0);
+
+  if (result == 0 && t.rxLen) {
+    if (Wire.requestFrom(t.address, t.rxLen) != t.rxLen) {
+      result = WIRE_ERROR;
+    } else {
+      for (uint8_t n = 0; n < t.rxLen; n++) {
+        t.rx[n] = Wire.read();
+      }
+    }
+  }
+  return result;
+}
+
+void HwI2CBus::_execute(I2CTransaction &t) {
+  uint32_t start = micros();
+  TRACE_EVENT(TRACE_I2C_BEGIN, t.address, t.priority, t.tag);
+
+  int d = _deviceIndex(t.address);
+  uint8_t result;
+  for (int attempt = 0;; attempt++) {
+    uint32_t clock = _clock;
+    if (d >= 0 && _deviceMaxClock[d] && _deviceMaxClock[d] < clock)
+      clock = _deviceMaxClock[d];
+    _applyClock(clock);
+
+    result = _attempt(t);
+    if (d >= 0) {
+      _enterQueue();
+      I2CDeviceStats &ds = _stats.device[d];
+      ds.attempts++;
+      if (result == WIRE_NACK_ADDRESS || result == WIRE_NACK_DATA)
+        ds.nacks++;
+      else if (result == WIRE_TIMEOUT)
+        ds.timeouts++;
+      else if (result != 0)
+        ds.errors++;
+      _exitQueue();
+    }
+    if (result == 0) {
+      if (d >= 0)
+        _devicePresent[d] = true;
+      if (clock == _clock)
+        _clockConfirmed = true;
+      break;
+    }
+    if (result != WIRE_NACK_ADDRESS && result != WIRE_NACK_DATA &&
+        result != WIRE_ERROR && result != WIRE_TIMEOUT)
+      break; // Not a bus problem (e.g. too long)
+
+    // Address NACK from a device that never answered, while others work
+    // at this clock: it is absent (a probe), fail fast
+    if (result == WIRE_NACK_ADDRESS && _clockConfirmed &&
+        !(d >= 0 && _devicePresent[d]))
+      break;
+
+    _noteError(t.address, result);
+    if (result == WIRE_TIMEOUT || result == WIRE_ERROR)
+      _recoverBus();
+    if (attempt >= I2C_BUS_RETRIES)
+      break;
+    _enterQueue();
+    _stats.retries++;
+    _exitQueue();
+  }
+
+  uint32_t end = micros();
+  TRACE_EVENT(TRACE_I2C_END, t.address, t.priority, result);
+  uint32_t latency = end - t.submittedUs;
+  I2CPriorityStats &ps = _stats.priority[t.priority];
+
+  _enterQueue();
+  t.result = result;
+  t.completedUs = end;
+  ps.count++;
+  if (result != 0)
+    ps.errors++;
+  ps.totalLatencyUs += latency;
+  if (latency > ps.maxLatencyUs)
+    ps.maxLatencyUs = latency;
+  _stats.busyUs += end - start;
+  t.state = I2C_TXN_DONE;
+  _exitQueue();
+}
+
+void HwI2CBus::_noteError(uint8_t address, uint8_t result) {
+  // Errors from devices that work at a lower clock: long or noisy wiring
+  uint32_t now = millis();
+  if (now - _errorWindowStart > I2C_BUS_BACKOFF_WINDOW_MS) {
+    _errorWindowStart = now;
+    _windowErrors = 0;
+  }
+  if (++_windowErrors < I2C_BUS_BACKOFF_ERRORS ||
+      _clock <= I2C_CLOCK_MIN_SPEED)
+    return;
+
+  uint32_t lower = I2C_CLOCK_MIN_SPEED;
+  for (uint32_t step : CLOCK_STEPS) {
+    if (step < _clock && step > lower) {
+      lower = step;
+      break;
+    }
+  }
+  Logger.warning("I2C bus: %d errors in %d ms (0x%X: %d), clock down to "
+                 "%lu kHz",
+                 _windowErrors, I2C_BUS_BACKOFF_WINDOW_MS,
+                 address, result, (unsigned long)lower / 1000);
+  _clock = lower;
+  _clockConfirmed = false;
+  _enterQueue();
+  _stats.backoffs++;
+  _exitQueue();
+  _windowErrors = 0;
+}
+
+void HwI2CBus::_recoverBus() {
+  uint32_t start = micros();
+  Wire.end();
+
+#ifdef ARDUINO_ARCH_ESP32
+  // A device stopped mid-byte holds SDA low until it has shifted out the
+  // rest of the byte: clock SCL (at most 9 times) until SDA is released,
+  // then send a STOP
+  pinMode(I2C_SDA_PIN, INPUT_PULLUP);
+  pinMode(I2C_SCL_PIN, OUTPUT_OPEN_DRAIN);
+  digitalWrite(I2C_SCL_PIN, HIGH);
+  delayMicroseconds(5);
+  for (int i = 0; i < 9 && digitalRead(I2C_SDA_PIN) == LOW; i++) {
+    digitalWrite(I2C_SCL_PIN, LOW);
+    delayMicroseconds(5);
+    digitalWrite(I2C_SCL_PIN, HIGH);
+    delayMicroseconds(5);
+  }
+  pinMode(I2C_SDA_PIN, OUTPUT_OPEN_DRAIN);
+  digitalWrite(I2C_SCL_PIN, LOW);
+  digitalWrite(I2C_SDA_PIN, LOW);
+  delayMicroseconds(5);
+  digitalWrite(I2C_SCL_PIN, HIGH);
+  delayMicroseconds(5);
+  digitalWrite(I2C_SDA_PIN, HIGH);
+  delayMicroseconds(5);
+#endif
+
+  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+  Wire.setTimeOut(I2C_BUS_TIMEOUT_MS);
+  _wireClock = 0;
+  _enterQueue();
+  _stats.recoveries++;
+  _exitQueue();
+
+  // A dead bus would recover on every attempt: one line per window
+  uint32_t now = millis();
+  if (now - _lastRecoveryLog >= I2C_BUS_BACKOFF_WINDOW_MS) {
+    _lastRecoveryLog = now;
+    Logger.warning("I2C bus: cleared and restarted in %lu us (%lu so far)",
+                   (unsigned long)(micros() - start),
+                   (unsigned long)_stats.recoveries);
+  }
+}
+
+void HwI2CBus::_dispatch() {
+  for (int i = 0; i < I2C_BUS_QUEUE_DEPTH; i++) {
+    I2CTransaction &t = _slots[i];
+    if (t.state != I2C_TXN_DONE || !t.onComplete)
+      continue;
+    t.onComplete(t, t.context);
+    release(i);
+  }
+}
+
+void HwI2CBus::update() {
+  _dispatch();
+
+  // Warn when the bus was busy for most of the last window
+  uint32_t now = millis();
+  uint32_t window = now - _windowStart;
+  if (window < I2C_BUS_STATS_WINDOW_MS)
+    return;
+  uint64_t busy = _stats.busyUs - _windowBusyUs;
+  uint32_t pct = (uint32_t)(busy / 10 / window);
+  if (pct >= I2C_BUS_SATURATION_PCT) {
+    Logger.warning("I2C bus saturated: %lu%% busy over %lu ms",
+                   (unsigned long)pct, (unsigned long)window);
+    logStats();
+  }
+  _windowStart = now;
+  _windowBusyUs = _stats.busyUs;
+}
+
+void HwI2CBus::getStats(I2CBusStats &stats) {
+  _enterQueue();
+  stats = _stats;
+  _exitQueue();
+  stats.clockHz = _clock;
+  stats.elapsedUs = (uint64_t)(millis() - _statsSince) * 1000;
+}
+
+void HwI2CBus::resetStats() {
+  _enterQueue();
+  memset(&_stats, 0, sizeof(_stats));
+  for (int d = 0; d < _deviceCount; d++)
+    _stats.device[d].address = _deviceAddress[d];
+  _stats.deviceCount = _deviceCount;
+  _exitQueue();
+  _statsSince = millis();
+  _windowStart = _statsSince;
+  _windowBusyUs = 0;
+}
+
+void HwI2CBus::logStats() {
+  I2CBusStats s;
+  getStats(s);
+  uint32_t pct = s.elapsedUs ? (uint32_t)(s.busyUs * 100 / s.elapsedUs) : 0;
+  Logger.info("I2C bus: %lu kHz, %lu%% busy, max queued %d, %lu rejected",
+              (unsigned long)s.clockHz / 1000, (unsigned long)pct,
+              s.maxQueued, (unsigned long)s.queueFull);
+  if (s.retries || s.recoveries || s.backoffs)
+    Logger.info("  %lu retries, %lu recoveries, %lu clock backoffs",
+                (unsigned long)s.retries, (unsigned long)s.recoveries,
+                (unsigned long)s.backoffs);
+  for (int p = 0; p < I2C_PRIO_COUNT; p++) {
+    const I2CPriorityStats &ps = s.priority[p];
+    if (!ps.count)
+      continue;
+    Logger.info("  %-5s %lu txn, %lu errors, latency avg %lu us max %lu us",
+                PRIORITY_NAMES[p], (unsigned long)ps.count,
+                (unsigned long)ps.errors,
+                (unsigned long)(ps.totalLatencyUs / ps.count),
+                (unsigned long)ps.maxLatencyUs);
+  }
+  for (int d = 0; d < s.deviceCount; d++) {
+    const I2CDeviceStats &ds = s.device[d];
+    if (ds.attempts == 0 || ds.nacks + ds.timeouts + ds.errors == 0)
+      continue;
+    Logger.info("  0x%02X  %lu tries, %lu NACK, %lu timeout, %lu other",
+                ds.address, (unsigned long)ds.attempts,
+                (unsigned long)ds.nacks, (unsigned long)ds.timeouts,
+                (unsigned long)ds.errors);
+  }
+}
@@ -0,0 +1,184 @@
+#ifndef HW_I2C_BUS_H
+#define HW_I2C_BUS_H
+
+#include "config.h"
+#include <Arduino.h>
+#include <Wire.h>
+
+#if I2C_BUS_USE_TASK
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+
+// Transactions are served in this order, FIFO within a priority
+enum I2CPriority {
+  I2C_PRIO_SERVO,       // PCA9685 frames
+  I2C_PRIO_RTC,         // DS3231 time reads
+  I2C_PRIO_TEMPERATURE, // DS3231 temperature
+  I2C_PRIO_COUNT
+};
+
+enum I2CTransactionState {
+  I2C_TXN_FREE,
+  I2C_TXN_QUEUED,
+  I2C_TXN_RUNNING,
+  I2C_TXN_DONE
+};
+
+struct I2CTransaction;
+typedef void (*I2CCallback)(const I2CTransaction &txn, void *context);
+
+// A write, optionally followed by a read with a repeated start
+struct I2CTransaction {
+  volatile uint8_t state; // I2CTransactionState
+  uint8_t priority;
+  uint8_t address;
+  uint8_t txLen;
+  uint8_t rxLen;
+  uint8_t result; // Wire error code, 0 = success
+  uint8_t tx[I2C_BUS_MAX_TX];
+  uint8_t rx[I2C_BUS_MAX_RX];
+  uint32_t sequence; // Submission order
+  uint32_t tag;      // Caller data for the callback
+  uint32_t submittedUs;
+  uint32_t completedUs;
+  I2CCallback onComplete;
+  void *context;
+};
+
+struct I2CPriorityStats {
+  uint32_t count;
+  uint32_t errors;
+  uint64_t totalLatencyUs; // Submit -> completion
+  uint32_t maxLatencyUs;
+};
+
+// Per attempt: a retried transaction counts once per try
+struct I2CDeviceStats {
+  uint8_t address;
+  uint32_t attempts;
+  uint32_t nacks;    // Address or data not acknowledged
+  uint32_t timeouts; // Bus held (stuck SDA/SCL)
+  uint32_t errors;   // Any other failure
+};
+
+struct I2CBusStats {
+  I2CPriorityStats priority[I2C_PRIO_COUNT];
+  I2CDeviceStats device[I2C_BUS_MAX_DEVICES]; // First deviceCount in use
+  uint8_t deviceCount;
+  uint64_t busyUs;     // Time spent executing transactions
+  uint64_t elapsedUs;  // Since the last reset
+  uint32_t queueFull;  // Rejected submissions
+  uint8_t maxQueued;   // High-water mark of queued transactions
+  uint32_t retries;    // Extra attempts of failed transactions
+  uint32_t recoveries; // Bus clear + re-init after a hung bus
+  uint32_t backoffs;   // Clock steps down
+  uint32_t clockHz;    // Current bus clock
+};
+
+// Owns the Wire peripheral. Drivers submit transactions and get their
+// completions without blocking; on the ESP32 a FreeRTOS task executes them
+// by priority, on host builds they run inside submit().
+//
+// The bus starts at I2C_CLOCK_SPEED (Fast-mode Plus) and steps down to
+// 400 and then 100 kHz when transactions keep failing (an address NACK
+// from a device that never answered counts as absent, not as an error).
+// A failed attempt is retried up to I2C_BUS_RETRIES times; a timeout or
+// bus error first clears the bus (SCL clocked until SDA is released, STOP)
+// and restarts Wire. With the I2C_BUS_TIMEOUT_MS Wire timeout, a transaction
+// on a dead bus completes (with an error) in about
+// (1 + I2C_BUS_RETRIES) * I2C_BUS_TIMEOUT_MS.
+class HwI2CBus {
+public:
+  HwI2CBus();
+
+  // Call after Wire.begin(): sets the boot clock and the Wire timeout
+  void begin();
+
+  // Highest clock a device supports (the DS3231 has no Fast-mode Plus):
+  // its transactions run at the lower of this and the bus clock
+  void setDeviceMaxClock(uint8_t address, uint32_t maxClock);
+  uint32_t getClock() { return _clock; }
+
+  // Queue a transaction. Returns a handle, or -1 if the queue stays full.
+  // With a callback the slot is freed once the callback has run, from
+  // update() or a later submit() with a callback: submit callback
+  // transactions and call update() from the same task. Without one, poll
+  // isDone() and release() the handle.
+  int submit(uint8_t address, I2CPriority priority, const uint8_t *tx,
+             uint8_t txLen, uint8_t rxLen = 0, I2CCallback onComplete = NULL,
+             void *context = NULL, uint32_t tag = 0);
+
+  bool isDone(int handle);
+  const I2CTransaction &get(int handle);
+  void release(int handle);
+
+  // Submit and wait for the result (setup-time or rare calls). Returns the
+  // Wire error code; rx receives rxLen bytes on success.
+  uint8_t transfer(uint8_t address, I2CPriority priority, const uint8_t *tx,
+                   uint8_t txLen, uint8_t *rx = NULL, uint8_t rxLen = 0);
+
+  // Exclusive bus access for libraries that use Wire directly (init, RTC
+  // adjust), at no more than I2C_DIRECT_CLOCK_SPEED since any device may be
+  // addressed. Hold it only briefly and never around transfer().
+  void lock();
+  void unlock();
+
+  // Run completion callbacks and the saturation check (call from the task
+  // that submits callback transactions, i.e. the motion task)
+  void update();
+
+  void getStats(I2CBusStats &stats);
+  void resetStats();
+  void logStats();
+
+private:
+  I2CTransaction _slots[I2C_BUS_QUEUE_DEPTH];
+  uint32_t _nextSequence;
+  I2CBusStats _stats;
+  uint32_t _statsSince;
+  uint32_t _windowStart;
+  uint64_t _windowBusyUs;
+  bool _started;
+
+  // Adaptive clock
+  uint32_t _clock;     // Bus clock for managed transactions
+  uint32_t _wireClock; // Clock Wire is set to, 0 = unknown
+  bool _clockConfirmed; // A transaction succeeded at _clock
+  uint32_t _errorWindowStart;
+  uint8_t _windowErrors;
+  uint32_t _lastRecoveryLog;
+
+  // Devices seen on the bus; stats entries share the index
+  uint8_t _deviceAddress[I2C_BUS_MAX_DEVICES];
+  uint32_t _deviceMaxClock[I2C_BUS_MAX_DEVICES]; // 0 = bus clock
+  bool _devicePresent[I2C_BUS_MAX_DEVICES]; // Acknowledged at least once
+  uint8_t _deviceCount;
+
+#if I2C_BUS_USE_TASK
+  TaskHandle_t _task;
+  SemaphoreHandle_t _busMutex;
+  portMUX_TYPE _queueMux;
+  static void _taskMain(void *arg);
+#endif
+
+  void _enterQueue();
+  void _exitQueue();
+  void _takeBus();
+  void _giveBus();
+  int _claimSlot();
+  int _nextQueued();
+  void _execute(I2CTransaction &txn);
+  uint8_t _attempt(I2CTransaction &txn);
+  int _deviceIndex(uint8_t address);
+  void _applyClock(uint32_t clock);
+  void _noteError(uint8_t address, uint8_t result);
+  void _recoverBus();
+  void _service();
+  void _dispatch();
+};
+
+extern HwI2CBus I2CBus;
+
+#endif // HW_I2C_BUS_H
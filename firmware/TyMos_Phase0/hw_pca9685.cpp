@@ -1,9 +1,20 @@
 #include "hw_pca9685.h"
 #include "utils_logger.h"
+#include "utils_trace.h"
 
 HwPCA9685::HwPCA9685() {
   _pwmHours = NULL;
   _pwmMinutes = NULL;
+  _frameDepth = 0;
+  for (int b = 0; b < PCA9685_NUM_BOARDS; b++) {
+    _known[b] = 0;
+    _dirty[b] = 0;
+    _failures[b] = 0;
+    for (int c = 0; c < 16; c++) {
+      _shadowOn[b][c] = 0;
+      _shadowOff[b][c] = 0;
+    }
+  }
 }
 
 void HwPCA9685::begin(uint8_t addrHours, uint8_t addrMinutes, uint8_t freq) {
@@ -12,6 +23,8 @@ void HwPCA9685::begin(uint8_t addrHours, uint8_t addrMinutes, uint8_t freq) {
   _pwmHours = new Adafruit_PWMServoDriver(addrHours);
   _pwmMinutes = new Adafruit_PWMServoDriver(addrMinutes);
 
+  // The Adafruit driver talks to Wire directly
+  I2CBus.lock();
   if (_pwmHours) {
     _pwmHours->begin();
     _pwmHours->setPWMFreq(freq);
@@ -28,12 +41,16 @@ void HwPCA9685::begin(uint8_t addrHours, uint8_t addrMinutes, uint8_t freq) {
   } else {
     Logger.error("Failed to allocate PCA9685 Minutes object");
   }
+  I2CBus.unlock();
 }
 
 void HwPCA9685::setupI2C() {
+  // The bus manager sets the clock (adaptive, see hw_i2c_bus.h)
+  I2CBus.lock();
   Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
-  Wire.setClock(I2C_CLOCK_SPEED);
-  Logger.info("I2C initialized at 400kHz");
+  I2CBus.unlock();
+  Logger.info("I2C initialized at %lu kHz",
+              (unsigned long)I2CBus.getClock() / 1000);
 }
 
 Adafruit_PWMServoDriver *HwPCA9685::_getDriver(uint8_t boardAddress) {
@@ -44,25 +61,177 @@ Adafruit_PWMServoDriver *HwPCA9685::_getDriver(uint8_t boardAddress) {
   return NULL;
 }
 
+int HwPCA9685::_getBoardIndex(uint8_t boardAddress) {
+  if (boardAddress == PCA9685_ADDR_HOURS)
+    return 0;
+  if (boardAddress == PCA9685_ADDR_MINUTES)
+    return 1;
+  return -1;
+}
+
+uint8_t HwPCA9685::_getBoardAddress(int boardIndex) {
+  return (boardIndex == 0) ? PCA9685_ADDR_HOURS : PCA9685_ADDR_MINUTES;
+}
+
 void HwPCA9685::setPWM(uint8_t boardAddress, uint8_t channel, uint16_t on,
                        uint16_t off) {
-  Adafruit_PWMServoDriver *driver = _getDriver(boardAddress);
-  if (driver) {
-    driver->setPWM(channel, on, off);
-  } else {
+  int bIdx = _getBoardIndex(boardAddress);
+  if (bIdx < 0 || !_getDriver(boardAddress)) {
     Logger.error("setPWM: Invalid board address 0x%X", boardAddress);
+    return;
+  }
+  if (channel > 15)
+    return;
+
+  uint16_t bit = (uint16_t)(1u << channel);
+
+  // Same value already on the chip (or pending): nothing to do
+  if ((_known[bIdx] & bit) && _shadowOn[bIdx][channel] == on &&
+      _shadowOff[bIdx][channel] == off)
+    return;
+
+  TRACE_EVENT(TRACE_PWM_SET, boardAddress, channel, off);
+  _shadowOn[bIdx][channel] = on;
+  _shadowOff[bIdx][channel] = off;
+  _known[bIdx] |= bit;
+  _dirty[bIdx] |= bit;
+
+  if (_frameDepth == 0) {
+    flush();
+  }
+}
+
+void HwPCA9685::setPulse(uint8_t boardAddress, uint8_t channel,
+                         uint16_t width) {
+  uint16_t on = phaseOffset(channel);
+  setPWM(boardAddress, channel, on, (on + width) & 0x0FFF);
+}
+
+void HwPCA9685::beginFrame() { _frameDepth++; }
+
+void HwPCA9685::endFrame() {
+  if (_frameDepth == 0)
+    return;
+  if (--_frameDepth == 0) {
+    flush();
+  }
+}
+
+void HwPCA9685::flush() {
+  for (int b = 0; b < PCA9685_NUM_BOARDS; b++) {
+    uint16_t dirty = _dirty[b];
+    uint16_t pending = 0;
+    _dirty[b] = 0; // A completion may mark channels again meanwhile
+    uint8_t ch = 0;
+
+    // Walk runs of dirty channels. A run bridges up to
+    // PCA9685_BURST_MAX_GAP clean channels whose chip value is known
+    // (rewriting them is harmless), so scattered changes such as a batch
+    // of detaches still go out as one transaction.
+    while (dirty && ch < 16) {
+      if (!(dirty & (1u << ch))) {
+        ch++;
+        continue;
+      }
+
+      uint8_t first = ch;
+      uint8_t last = ch;
+      uint16_t run = 0;
+      while (ch < 16 && (ch - first) < PCA9685_BURST_MAX_CHANNELS) {
+        uint16_t bit = (uint16_t)(1u << ch);
+        if (dirty & bit) {
+          dirty &= ~bit;
+          run |= bit;
+          last = ch;
+        } else if (!dirty || !(_known[b] & bit) ||
+                   ch - last > PCA9685_BURST_MAX_GAP) {
+          break;
+        }
+        ch++;
+      }
+      ch = last + 1;
+
+      if (!_writeBurst(b, first, last - first + 1)) {
+        // Queue full: keep the run dirty for the next flush
+        pending |= run;
+      }
+    }
+    _dirty[b] |= pending;
+  }
+}
+
+bool HwPCA9685::_writeBurst(int boardIndex, uint8_t first, uint8_t count) {
+  uint8_t addr = _getBoardAddress(boardIndex);
+
+  // MODE1.AI is set by setPWMFreq(), so registers auto-increment
+  uint8_t buf[1 + 4 * PCA9685_BURST_MAX_CHANNELS];
+  uint8_t len = 0;
+  buf[len++] = PCA9685_LED0_ON_L + 4 * first;
+  for (uint8_t c = first; c < first + count; c++) {
+    uint16_t on = _shadowOn[boardIndex][c];
+    uint16_t off = _shadowOff[boardIndex][c];
+    buf[len++] = on & 0xFF;
+    buf[len++] = on >> 8;
+    buf[len++] = off & 0xFF;
+    buf[len++] = off >> 8;
+  }
+
+  uint32_t tag = ((uint32_t)boardIndex << 16) | ((uint32_t)first << 8) | count;
+  return I2CBus.submit(addr, I2C_PRIO_SERVO, buf, len, 0, _onBurstDone, this,
+                       tag) >= 0;
+}
+
+void HwPCA9685::_onBurstDone(const I2CTransaction &txn, void *context) {
+  HwPCA9685 *self = (HwPCA9685 *)context;
+  int b = (txn.tag >> 16) & 0xFF;
+  if (txn.result == 0) {
+    self->_failures[b] = 0;
+    return;
+  }
+
+  uint8_t first = (txn.tag >> 8) & 0xFF;
+  uint8_t count = txn.tag & 0xFF;
+
+  // The bus manager already retried. Unknown chip state: the channels
+  // are sent again from the shadow by the next flush(), a few times in a
+  // row at most, then only by their next change.
+  bool resend = self->_failures[b] < PCA9685_FRAME_RETRIES;
+  if (resend)
+    self->_failures[b]++;
+  Logger.error("PCA9685 0x%X: burst write ch %d-%d failed (%d)%s",
+               txn.address, first, first + count - 1, txn.result,
+               resend ? ", resending" : "");
+  for (uint8_t c = first; c < first + count; c++) {
+    self->_known[b] &= ~(1u << c);
+    if (resend)
+      self->_dirty[b] |= 1u << c;
   }
 }
 
+bool HwPCA9685::hasPending() {
+  for (int b = 0; b < PCA9685_NUM_BOARDS; b++) {
+    if (_dirty[b])
+      return true;
+  }
+  return false;
+}
+
 void HwPCA9685::reset(uint8_t boardAddress) {
   Adafruit_PWMServoDriver *driver = _getDriver(boardAddress);
   if (driver) {
+    I2CBus.lock();
     driver->reset();
+    I2CBus.unlock();
+
+    // Registers are back to power-on defaults
+    int bIdx = _getBoardIndex(boardAddress);
+    _known[bIdx] = 0;
+    _dirty[bIdx] = 0;
     Logger.info("Reset PCA9685 at 0x%X", boardAddress);
   }
 }
 
 bool HwPCA9685::isConnected(uint8_t boardAddress) {
-  Wire.beginTransmission(boardAddress);
-  return (Wire.endTransmission() == 0);
+  // Address-only write: ACK means the board is present
+  return I2CBus.transfer(boardAddress, I2C_PRIO_SERVO, NULL, 0) == 0;
 }
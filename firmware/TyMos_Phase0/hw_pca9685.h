@@ -2,6 +2,7 @@
 #define HW_PCA9685_H
 
 #include "config.h"
+#include "hw_i2c_bus.h"
 #include <Adafruit_PWMServoDriver.h>
 #include <Arduino.h>
 #include <Wire.h>
@@ -11,7 +12,32 @@ public:
   HwPCA9685();
   void begin(uint8_t addrHours, uint8_t addrMinutes, uint8_t freq);
   void setupI2C();
+
+  // Update the shadow registers of a channel. Unchanged values are skipped.
+  // Written immediately unless a frame is open (see beginFrame).
   void setPWM(uint8_t boardAddress, uint8_t channel, uint16_t on, uint16_t off);
+
+  // Servo pulse of `width` counts. Each channel starts its pulse at its own
+  // phase offset instead of count 0, so the servos on a board do not all
+  // draw their current spike at the same moment of the frame; OFF wraps
+  // past the end of the period when needed.
+  void setPulse(uint8_t boardAddress, uint8_t channel, uint16_t width);
+  static uint16_t phaseOffset(uint8_t channel) {
+    return (uint16_t)((channel * PCA9685_PHASE_STEP) & 0x0FFF);
+  }
+
+  // Frame batching: setPWM calls between beginFrame() and endFrame() are
+  // only buffered, endFrame() flushes them. Frames can be nested.
+  void beginFrame();
+  void endFrame();
+
+  // Queue all dirty channels on the I2C bus manager, one auto-increment
+  // burst per range (small gaps of unchanged channels are bridged)
+  void flush();
+
+  // Channels waiting for a flush() (a queue-full or failed burst)
+  bool hasPending();
+
   void reset(uint8_t boardAddress);
   bool isConnected(uint8_t boardAddress);
 
@@ -19,8 +45,25 @@ private:
   Adafruit_PWMServoDriver *_pwmHours;
   Adafruit_PWMServoDriver *_pwmMinutes;
 
+  // Shadow of the LEDn_ON/LEDn_OFF registers, per board
+  uint16_t _shadowOn[PCA9685_NUM_BOARDS][16];
+  uint16_t _shadowOff[PCA9685_NUM_BOARDS][16];
+  uint16_t _known[PCA9685_NUM_BOARDS]; // Bit set: shadow matches the chip
+  uint16_t _dirty[PCA9685_NUM_BOARDS]; // Bit set: shadow not yet written
+  uint8_t _failures[PCA9685_NUM_BOARDS]; // Bursts failed in a row
+  uint8_t _frameDepth;
+
   // Internal helper to get the correct driver instance
   Adafruit_PWMServoDriver *_getDriver(uint8_t boardAddress);
+  int _getBoardIndex(uint8_t boardAddress);
+  uint8_t _getBoardAddress(int boardIndex);
+
+  // Queue channels [first, first + count) of a board as one transaction
+  bool _writeBurst(int boardIndex, uint8_t first, uint8_t count);
+
+  // Burst completion (from I2CBus.update): a failed write leaves the chip
+  // state unknown and is re-sent
+  static void _onBurstDone(const I2CTransaction &txn, void *context);
 };
 
 #endif // HW_PCA9685_H
@@ -1,41 +1,215 @@
 #include "hw_rtc.h"
+#include "config.h"
 #include "utils_logger.h"
+#include "utils_trace.h"
 
 RTCDriver RTC;
 
-RTCDriver::RTCDriver() {}
+RTCDriver::RTCDriver() {
+  _present = false;
+  _anchorUnix = SECONDS_FROM_1970_TO_2000;
+  _anchorMs = 0;
+  _cacheValid = false;
+  _anchorPrecise = false;
+  _resyncing = false;
+  _readHandle = -1;
+  _resyncSecond = 0;
+  _resyncStartedAt = 0;
+  _lastPollAt = 0;
+  _lastResyncAt = 0;
+}
 
 bool RTCDriver::begin() {
+  I2CBus.setDeviceMaxClock(DS3231_ADDRESS, RTC_I2C_MAX_CLOCK);
+
+  // RTClib talks to Wire directly
+  I2CBus.lock();
   if (!_rtc.begin()) {
+    I2CBus.unlock();
     Logger.error("Couldn't find RTC");
     return false;
   }
+  _present = true;
 
   if (_rtc.lostPower()) {
     Logger.warning("RTC lost power, setting to compile time!");
     _rtc.adjust(DateTime(F(__DATE__), F(__TIME__)));
   }
+  DateTime hw = _rtc.now();
+  I2CBus.unlock();
+
+  // The chip keeps time on its battery; NTP corrects it in the background
+  // once WiFi comes up (HwWiFi)
 
-  // Note: syncWithCompileTime() is now called only as fallback if NTP fails
-  // The main sketch handles NTP sync first, then falls back to compile time
+  // Coarse anchor now, the second edge is found by update()
+  _anchor(hw.unixtime(), millis());
+  _anchorPrecise = false;
+  requestResync();
 
   return true;
 }
 
-DateTime RTCDriver::now() { return _rtc.now(); }
+void RTCDriver::_anchor(uint32_t unixTime, uint32_t atMs) {
+  _anchorUnix = unixTime;
+  _anchorMs = atMs;
+  _cacheValid = false;
+}
+
+void RTCDriver::_advance() {
+  // Fold whole seconds into the anchor so the millis() delta stays small
+  uint32_t elapsed = millis() - _anchorMs;
+  if (elapsed >= 1000) {
+    uint32_t seconds = elapsed / 1000;
+    _anchorUnix += seconds;
+    _anchorMs += seconds * 1000;
+    _cacheValid = false;
+  }
+}
+
+DateTime RTCDriver::now() {
+  _advance();
+  if (!_cacheValid) {
+    // Traced only here: the cached path runs every loop iteration
+    TRACE_EVENT(TRACE_RTC_NOW, 0, 0, _anchorUnix);
+    _cached = DateTime(_anchorUnix);
+    _cacheValid = true;
+  }
+  return _cached;
+}
+
+uint16_t RTCDriver::millisIntoSecond() {
+  _advance();
+  return millis() - _anchorMs;
+}
+
+void RTCDriver::requestResync() {
+  if (!_present)
+    return;
+  _resyncing = true;
+  _resyncStartedAt = millis();
+  _lastPollAt = _resyncStartedAt - RTC_EDGE_POLL_INTERVAL_MS;
+  _resyncSecond = 0xFF;
+}
+
+DateTime RTCDriver::_decodeTime(const uint8_t *regs) {
+  // DS3231 registers 0x00-0x06 in BCD (24h mode, century bit ignored)
+  static const uint8_t MASKS[7] = {0x7F, 0x7F, 0x3F, 0x07, 0x3F, 0x1F, 0xFF};
+  uint8_t v[7];
+  for (int i = 0; i < 7; i++) {
+    uint8_t bcd = regs[i] & MASKS[i];
+    v[i] = bcd - 6 * (bcd >> 4);
+  }
+  return DateTime(2000 + v[6], v[5], v[4], v[2], v[1], v[0]);
+}
+
+void RTCDriver::update() {
+  uint32_t nowMs = millis();
+
+  // Previous read still queued or on the wire
+  if (_readHandle >= 0) {
+    if (!I2CBus.isDone(_readHandle))
+      return;
+    const I2CTransaction &t = I2CBus.get(_readHandle);
+    bool ok = t.result == 0 && _resyncing;
+    DateTime hw = ok ? _decodeTime(t.rx) : DateTime();
+    // Registers were sampled when the read completed, not now
+    uint32_t sinceRead = (uint32_t)micros() - t.completedUs;
+    uint32_t readAt = nowMs - sinceRead / 1000;
+    I2CBus.release(_readHandle);
+    _readHandle = -1;
+    if (ok)
+      _onTimeRead(hw, readAt);
+    return;
+  }
+
+  if (!_resyncing) {
+    if (_present && nowMs - _lastResyncAt >= RTC_RESYNC_INTERVAL_MS)
+      requestResync();
+    return;
+  }
+
+  // With a precise anchor the edge is due at the software second change,
+  // give or take the drift since then: start polling just before it
+  if (_resyncSecond == 0xFF && _anchorPrecise &&
+      millisIntoSecond() < 1000 - RTC_EDGE_GUARD_MS)
+    return;
+
+  if (nowMs - _lastPollAt < RTC_EDGE_POLL_INTERVAL_MS)
+    return;
+  _lastPollAt = nowMs;
+
+  const uint8_t reg = 0x00; // Seconds register, 7 bytes of time follow
+  _readHandle = I2CBus.submit(DS3231_ADDRESS, I2C_PRIO_RTC, &reg, 1, 7);
+}
+
+void RTCDriver::_onTimeRead(const DateTime &hw, uint32_t nowMs) {
+  // Wait for the chip's seconds to change: that read is the new anchor,
+  // late by at most one poll interval
+  if (_resyncSecond == 0xFF) {
+    // Drifted past the guard window: search the next edge blindly
+    if (hw.unixtime() != now().unixtime())
+      _anchorPrecise = false;
+    _resyncSecond = hw.second();
+    // The search times out from here, a blocking setup() may have delayed
+    // the first read well past requestResync()
+    _resyncStartedAt = nowMs;
+    return;
+  }
+
+  if (hw.second() == _resyncSecond) {
+    if (nowMs - _resyncStartedAt > RTC_EDGE_SEARCH_TIMEOUT_MS) {
+      Logger.warning("RTC: seconds not advancing, keeping software clock");
+      _resyncing = false;
+      _lastResyncAt = nowMs;
+    }
+    return;
+  }
+
+  _advance();
+  int32_t driftMs = (int32_t)(hw.unixtime() - _anchorUnix) * 1000 -
+                    (int32_t)(nowMs - _anchorMs);
+  _anchor(hw.unixtime(), nowMs);
+  _anchorPrecise = true;
+  _resyncing = false;
+  _lastResyncAt = nowMs;
+  Logger.info("RTC resync: software clock corrected by %ld ms",
+              (long)driftMs);
+}
 
 void RTCDriver::setTime(DateTime dt) {
+  I2CBus.lock();
   _rtc.adjust(dt);
+  I2CBus.unlock();
+  // Writing the seconds register restarts the chip's second
+  _anchor(dt.unixtime(), millis());
+  _anchorPrecise = true;
+  _resyncing = false;
+  _lastResyncAt = millis();
   Logger.info("RTC time manually set");
 }
 
-float RTCDriver::getTemperature() { return _rtc.getTemperature(); }
+float RTCDriver::getTemperature() {
+  // Lowest priority on the bus, behind servo frames and time reads
+  const uint8_t reg = 0x11; // Temperature MSB, LSB
+  uint8_t raw[2];
+  if (I2CBus.transfer(DS3231_ADDRESS, I2C_PRIO_TEMPERATURE, &reg, 1, raw, 2)) {
+    Logger.error("RTC: temperature read failed");
+    return NAN;
+  }
+  return (int8_t)raw[0] + (raw[1] >> 6) * 0.25f;
+}
 
 void RTCDriver::syncWithCompileTime() {
   DateTime compiled = DateTime(F(__DATE__), F(__TIME__));
 
   // ALWAYS overwrite RTC with compile time (as per user requirement)
+  I2CBus.lock();
   _rtc.adjust(compiled);
+  I2CBus.unlock();
+  _anchor(compiled.unixtime(), millis());
+  _anchorPrecise = true;
+  _resyncing = false;
+  _lastResyncAt = millis();
   Logger.info("RTC sincronizzato con ora compilazione: %02d:%02d:%02d",
               compiled.hour(), compiled.minute(), compiled.second());
 }
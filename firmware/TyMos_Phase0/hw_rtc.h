@@ -1,21 +1,59 @@
 #ifndef HW_RTC_H
 #define HW_RTC_H
 
+#include "hw_i2c_bus.h"
 #include <Arduino.h>
 #include <RTClib.h>
 #include <Wire.h>
 
+// DS3231 driver with a software clock. now() counts seconds from millis()
+// since the last anchor and does not touch the bus; the anchor is taken
+// from the chip at begin(), every RTC_RESYNC_INTERVAL_MS and on setTime().
 class RTCDriver {
 public:
   RTCDriver();
   bool begin();
+
+  // Software clock (no I2C)
   DateTime now();
+
+  // Milliseconds elapsed in the current second (0-999)
+  uint16_t millisIntoSecond();
+
+  // Re-anchor to the chip when due (non-blocking, call from loop)
+  void update();
+
+  // Re-anchor at the next update(), e.g. after an external time change
+  void requestResync();
+
   void setTime(DateTime dt);
   void syncWithCompileTime();
   float getTemperature();
 
 private:
   RTC_DS3231 _rtc;
+  bool _present;
+
+  // Software clock: _anchorUnix started at millis() == _anchorMs
+  uint32_t _anchorUnix;
+  uint32_t _anchorMs;
+  DateTime _cached; // now() for _anchorUnix, rebuilt once per second
+  bool _cacheValid;
+  bool _anchorPrecise; // Anchored on a chip second edge (or a write)
+
+  // Edge search: the chip's second changes between two reads, issued as
+  // asynchronous reads on the I2C bus manager
+  bool _resyncing;
+  int _readHandle; // Time read in flight, -1 if none
+  uint8_t _resyncSecond;
+  uint32_t _resyncStartedAt;
+  uint32_t _lastPollAt;
+  uint32_t _lastResyncAt;
+
+  void _anchor(uint32_t unixTime, uint32_t atMs);
+  void _onTimeRead(const DateTime &hw, uint32_t nowMs);
+  static DateTime _decodeTime(const uint8_t *regs);
+  void _advance();
   DateTime _getCompileDateTime();
 };
 
@@ -1,8 +1,11 @@
 #include "hw_wifi.h"
+#include "config.h"
 #include "hw_rtc.h"
 #include "utils_logger.h"
 #include <ArduinoOTA.h>
 #include <WiFi.h>
+#include <esp_sntp.h>
+#include <sys/time.h>
 #include <time.h>
 
 // Include secrets file for WiFi credentials and OTA password
@@ -18,128 +21,175 @@ const char *OTA_HOSTNAME = "TyMos-Clock";
 // External RTC driver
 extern RTCDriver rtcDriver;
 
+// Event flags raised by the WiFi event and SNTP tasks
+#define WIFI_EVENT_DISCONNECTED 0x01
+#define WIFI_EVENT_NTP_SYNC 0x02
+
+HwWiFi *HwWiFi::_instance = NULL;
+
 HwWiFi::HwWiFi() {
-  _connected = false;
+  _state = WIFI_STATE_OFF;
+  _stateSince = 0;
+  _backoffMs = WIFI_BACKOFF_MIN_MS;
+  _attempts = 0;
+  _ntpStarted = false;
+  _otaStarted = false;
+  _timeSynced = false;
+  _ntpPending = false;
+  _ntpSecond = -1;
   _lastNTPSync = 0;
+  _events = 0;
+  _linkUp = false;
+  _disconnectReason = 0;
 }
 
-bool HwWiFi::begin() {
-  Logger.info("Connecting to WiFi: %s", WIFI_SSID);
+void HwWiFi::begin() {
+  _instance = this;
 
   WiFi.mode(WIFI_STA);
   WiFi.setHostname(OTA_HOSTNAME);
+  // Reconnects are paced by update() instead of the driver's tight retries
+  WiFi.setAutoReconnect(false);
+
+  WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) {
+    switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      _linkUp = true;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      _linkUp = false;
+      _disconnectReason = info.wifi_sta_disconnected.reason;
+      _events |= WIFI_EVENT_DISCONNECTED;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+      _linkUp = false;
+      _events |= WIFI_EVENT_DISCONNECTED;
+      break;
+    default:
+      break;
+    }
+  });
+
+  // SNTP reports every sync (first one and every NTP_SYNC_INTERVAL_MS)
+  sntp_set_time_sync_notification_cb(_onTimeSync);
+  sntp_set_sync_interval(NTP_SYNC_INTERVAL_MS);
+
+  _connect();
+}
+
+void HwWiFi::_onTimeSync(struct timeval *tv) {
+  (void)tv;
+  if (_instance)
+    _instance->_events |= WIFI_EVENT_NTP_SYNC;
+}
+
+void HwWiFi::_connect() {
+  Logger.info("Connecting to WiFi: %s", WIFI_SSID);
   WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  _state = WIFI_STATE_CONNECTING;
+  _stateSince = millis();
+}
+
+void HwWiFi::update() {
+  uint8_t events = _events.exchange(0);
+  uint32_t now = millis();
 
-  // Wait for connection (timeout 15 seconds)
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 30) {
-    delay(500);
-    attempts++;
+  // The link flag holds the latest state, the event bit catches failed
+  // attempts that never came up
+  bool up = _linkUp;
+  if (up && _state != WIFI_STATE_CONNECTED) {
+    _onConnected();
+  } else if (!up && (_state == WIFI_STATE_CONNECTED ||
+                     (_state == WIFI_STATE_CONNECTING &&
+                      (events & WIFI_EVENT_DISCONNECTED)))) {
+    WiFi.disconnect();
+    _onDisconnected(_disconnectReason);
+  } else if (_state == WIFI_STATE_CONNECTING &&
+             now - _stateSince >= WIFI_CONNECT_TIMEOUT_MS) {
+    WiFi.disconnect();
+    _onDisconnected(0);
+  } else if (_state == WIFI_STATE_BACKOFF && now - _stateSince >= _backoffMs) {
+    _connect();
   }
 
-  if (WiFi.status() == WL_CONNECTED) {
-    _connected = true;
-    Logger.info("WiFi connected! IP: %s", WiFi.localIP().toString().c_str());
+  if (events & WIFI_EVENT_NTP_SYNC) {
+    _ntpPending = true;
+    _ntpSecond = -1;
+  }
+  if (_ntpPending)
+    _applyNTP();
+}
+
+void HwWiFi::_onConnected() {
+  _state = WIFI_STATE_CONNECTED;
+  _stateSince = millis();
+  _attempts = 0;
+  Logger.info("WiFi connected! IP: %s", WiFi.localIP().toString().c_str());
 
-    // Configure NTP
+  if (!_ntpStarted) {
+    // Starts SNTP in the background, _onTimeSync() reports the result
     configTime(TIMEZONE_OFFSET, 0, NTP_SERVER1, NTP_SERVER2);
+    _ntpStarted = true;
     Logger.info("NTP configured: %s, %s (Timezone offset: %d seconds)",
                 NTP_SERVER1, NTP_SERVER2, TIMEZONE_OFFSET);
-
-    // Initial NTP sync
-    syncNTP();
-
-    // Setup OTA
-    ArduinoOTA.setHostname(OTA_HOSTNAME);
-    ArduinoOTA.setPassword(OTA_PASSWORD);
-
-    ArduinoOTA.onStart([]() {
-      String type;
-      if (ArduinoOTA.getCommand() == U_FLASH) {
-        type = "sketch";
-      } else {
-        type = "filesystem";
-      }
-      Logger.info("OTA Start: %s", type.c_str());
-    });
-
-    ArduinoOTA.onEnd([]() { Logger.info("OTA End - Rebooting..."); });
-
-    ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
-      static int lastPercent = -1;
-      int percent = (progress / (total / 100));
-      if (percent != lastPercent && percent % 10 == 0) {
-        Logger.info("OTA Progress: %u%%", percent);
-        lastPercent = percent;
-      }
-    });
-
-    ArduinoOTA.onError([](ota_error_t error) {
-      const char *errorMsg;
-      switch (error) {
-      case OTA_AUTH_ERROR:
-        errorMsg = "Auth Failed";
-        break;
-      case OTA_BEGIN_ERROR:
-        errorMsg = "Begin Failed";
-        break;
-      case OTA_CONNECT_ERROR:
-        errorMsg = "Connect Failed";
-        break;
-      case OTA_RECEIVE_ERROR:
-        errorMsg = "Receive Failed";
-        break;
-      case OTA_END_ERROR:
-        errorMsg = "End Failed";
-        break;
-      default:
-        errorMsg = "Unknown";
-        break;
-      }
-      Logger.error("OTA Error: %s", errorMsg);
-    });
-
-    ArduinoOTA.begin();
-    Logger.info("OTA ready. Hostname: %s", OTA_HOSTNAME);
-
-    return true;
-  } else {
-    _connected = false;
-    Logger.warning("WiFi connection failed! Continuing offline...");
-    return false;
+  } else if (millis() - _lastNTPSync >= NTP_SYNC_INTERVAL_MS ||
+             !_timeSynced) {
+    // A sync may have been missed while offline
+    requestNTPSync();
   }
-}
 
-void HwWiFi::handleOTA() {
-  if (_connected) {
-    ArduinoOTA.handle();
+  if (!_otaStarted) {
+    _setupOTA();
+    _otaStarted = true;
   }
 }
 
-bool HwWiFi::syncNTP() {
-  if (!_connected) {
-    Logger.warning("Cannot sync NTP: WiFi not connected");
-    return false;
+void HwWiFi::_onDisconnected(uint8_t reason) {
+  _attempts++;
+  if (_state == WIFI_STATE_CONNECTED) {
+    Logger.warning("WiFi connection lost (reason %d)", reason);
+  } else if (reason) {
+    Logger.warning("WiFi connection failed (reason %d), attempt %d", reason,
+                   _attempts);
+  } else {
+    Logger.warning("WiFi connection timed out, attempt %d", _attempts);
+  }
+  if (_otaStarted) {
+    ArduinoOTA.end();
+    _otaStarted = false;
   }
 
-  Logger.info("Syncing time from NTP...");
+  // Double the wait per consecutive failure, up to WIFI_BACKOFF_MAX_MS
+  _backoffMs = WIFI_BACKOFF_MIN_MS;
+  for (uint16_t i = 1; i < _attempts && _backoffMs < WIFI_BACKOFF_MAX_MS; i++)
+    _backoffMs *= 2;
+  if (_backoffMs > WIFI_BACKOFF_MAX_MS)
+    _backoffMs = WIFI_BACKOFF_MAX_MS;
 
-  // Wait for NTP time (max 5 seconds)
-  struct tm timeinfo;
-  int attempts = 0;
-  while (!getLocalTime(&timeinfo) && attempts < 10) {
-    delay(500);
-    attempts++;
-  }
+  _state = WIFI_STATE_BACKOFF;
+  _stateSince = millis();
+  Logger.info("WiFi retry in %lu s", (unsigned long)(_backoffMs / 1000));
+}
 
-  if (attempts >= 10) {
-    Logger.error("NTP sync failed: timeout");
-    return false;
+void HwWiFi::_applyNTP() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+
+  // Wait for the system clock to start a new second
+  if (_ntpSecond < 0 || tv.tv_sec == _ntpSecond) {
+    _ntpSecond = tv.tv_sec;
+    return;
   }
+  _ntpPending = false;
+
+  struct tm timeinfo;
+  time_t seconds = tv.tv_sec;
+  localtime_r(&seconds, &timeinfo);
 
   // Update RTC with NTP time
-  DateTime ntpTime(timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
-                   timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+  DateTime ntpTime(timeinfo.tm_year + 1900, timeinfo.tm_mon + 1,
+                   timeinfo.tm_mday, timeinfo.tm_hour, timeinfo.tm_min,
+                   timeinfo.tm_sec);
 
   rtcDriver.setTime(ntpTime);
 
@@ -148,28 +198,89 @@ bool HwWiFi::syncNTP() {
               timeinfo.tm_min, timeinfo.tm_sec);
 
   _lastNTPSync = millis();
-  return true;
+  _timeSynced = true;
 }
 
-void HwWiFi::checkPeriodicSync() {
-  if (!_connected) {
-    return;
-  }
+void HwWiFi::_setupOTA() {
+  ArduinoOTA.setHostname(OTA_HOSTNAME);
+  ArduinoOTA.setPassword(OTA_PASSWORD);
+
+  ArduinoOTA.onStart([]() {
+    String type;
+    if (ArduinoOTA.getCommand() == U_FLASH) {
+      type = "sketch";
+    } else {
+      type = "filesystem";
+    }
+    Logger.info("OTA Start: %s", type.c_str());
+  });
+
+  ArduinoOTA.onEnd([]() {
+    Logger.info("OTA End - Rebooting...");
+    Logger.flush(); // The logger task would not get to print it
+  });
+
+  ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
+    static int lastPercent = -1;
+    int percent = (progress / (total / 100));
+    if (percent != lastPercent && percent % 10 == 0) {
+      Logger.info("OTA Progress: %u%%", percent);
+      lastPercent = percent;
+    }
+  });
 
-  // Check if 12 hours have passed since last sync
-  if (millis() - _lastNTPSync >= NTP_SYNC_INTERVAL_MS) {
-    Logger.info("Periodic NTP sync (12h interval)...");
-    syncNTP();
+  ArduinoOTA.onError([](ota_error_t error) {
+    const char *errorMsg;
+    switch (error) {
+    case OTA_AUTH_ERROR:
+      errorMsg = "Auth Failed";
+      break;
+    case OTA_BEGIN_ERROR:
+      errorMsg = "Begin Failed";
+      break;
+    case OTA_CONNECT_ERROR:
+      errorMsg = "Connect Failed";
+      break;
+    case OTA_RECEIVE_ERROR:
+      errorMsg = "Receive Failed";
+      break;
+    case OTA_END_ERROR:
+      errorMsg = "End Failed";
+      break;
+    default:
+      errorMsg = "Unknown";
+      break;
+    }
+    Logger.error("OTA Error: %s", errorMsg);
+  });
+
+  ArduinoOTA.begin();
+  Logger.info("OTA ready. Hostname: %s", OTA_HOSTNAME);
+}
+
+void HwWiFi::handleOTA() {
+  if (_otaStarted) {
+    ArduinoOTA.handle();
   }
 }
 
-bool HwWiFi::isConnected() {
-  _connected = (WiFi.status() == WL_CONNECTED);
-  return _connected;
+void HwWiFi::requestNTPSync() {
+  if (!_ntpStarted || _state != WIFI_STATE_CONNECTED) {
+    Logger.warning("Cannot sync NTP: WiFi not connected");
+    return;
+  }
+  Logger.info("Syncing time from NTP...");
+  sntp_restart();
 }
 
+bool HwWiFi::isConnected() { return _state == WIFI_STATE_CONNECTED; }
+
+bool HwWiFi::isTimeSynced() { return _timeSynced; }
+
+WiFiState HwWiFi::getState() { return _state; }
+
 String HwWiFi::getIPAddress() {
-  if (_connected) {
+  if (isConnected()) {
     return WiFi.localIP().toString();
   }
   return "Not connected";
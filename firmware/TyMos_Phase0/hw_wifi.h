@@ -2,35 +2,74 @@
 #define HW_WIFI_H
 
 #include <Arduino.h>
+#include <atomic>
 
+// Connection state machine, advanced by update()
+enum WiFiState {
+  WIFI_STATE_OFF,        // begin() not called yet
+  WIFI_STATE_CONNECTING, // Association / DHCP in progress
+  WIFI_STATE_CONNECTED,  // Got an IP, NTP and OTA running
+  WIFI_STATE_BACKOFF     // Waiting before the next connection attempt
+};
+
+// Non-blocking WiFi, NTP and OTA. WiFi events and SNTP notifications only
+// raise flags from their own tasks; update() acts on them from the control
+// loop, reconnects with exponential backoff and writes NTP time to the RTC.
 class HwWiFi {
 public:
   HwWiFi();
 
-  // Initialize WiFi, NTP and OTA
-  // Returns true if WiFi connected successfully
-  bool begin();
+  // Start connecting in the background (returns immediately)
+  void begin();
+
+  // Call from the control loop: connection state machine and NTP -> RTC
+  void update();
 
   // Call in loop() to handle OTA updates
   void handleOTA();
 
-  // Sync time from NTP server and update RTC
-  // Returns true if sync successful
-  bool syncNTP();
-
-  // Check if it's time for periodic NTP sync (every 12 hours)
-  void checkPeriodicSync();
+  // Ask SNTP for a fresh time sample (applied by update() when it arrives)
+  void requestNTPSync();
 
   // Get connection status
   bool isConnected();
 
+  // True once NTP time has been written to the RTC since boot
+  bool isTimeSynced();
+
+  WiFiState getState();
+
   // Get IP address as string
   String getIPAddress();
 
 private:
-  bool _connected;
+  WiFiState _state;
+  uint32_t _stateSince;
+  uint32_t _backoffMs;
+  uint16_t _attempts; // Failed attempts since the last connection
+  bool _ntpStarted;
+  bool _otaStarted;
+  bool _timeSynced;
+
+  // NTP time is written on the next second edge of the system clock, so
+  // the RTC and the software clock start the second in step with it
+  bool _ntpPending;
+  int32_t _ntpSecond; // Second seen while waiting for the edge, -1 if none
   unsigned long _lastNTPSync;
-  static const unsigned long NTP_SYNC_INTERVAL_MS = 12UL * 60UL * 60UL * 1000UL; // 12 hours
+
+  // Raised from the WiFi event and SNTP tasks
+  std::atomic<uint8_t> _events;
+  std::atomic<bool> _linkUp;
+  std::atomic<uint8_t> _disconnectReason;
+
+  static HwWiFi *_instance; // For the SNTP callback (no context pointer)
+
+  void _connect();
+  void _onConnected();
+  void _onDisconnected(uint8_t reason);
+  void _applyNTP();
+  void _setupOTA();
+  static void _onTimeSync(struct timeval *tv);
 };
 
 #endif // HW_WIFI_H
@@ -0,0 +1,142 @@
+#include "motion_calibration.h"
+#include "utils_logger.h"
+#include <Preferences.h>
+
+// Global instance
+MotionCalibration Calibration;
+
+// NVS layout
+static const char *CAL_NVS_NAMESPACE = "tymos-cal";
+static const char *CAL_NVS_KEY = "servo";
+static const uint16_t CAL_LAYOUT_VERSION = 1;
+
+struct StoredCalibration {
+  uint16_t version;
+  ServoCalibration channels[PCA9685_NUM_BOARDS][16];
+};
+
+MotionCalibration::MotionCalibration() { resetDefaults(); }
+
+int MotionCalibration::_getBoardIndex(uint8_t addr) {
+  if (addr == PCA9685_ADDR_HOURS)
+    return 0;
+  if (addr == PCA9685_ADDR_MINUTES)
+    return 1;
+  return -1;
+}
+
+bool MotionCalibration::_isValid(const ServoCalibration &cal, int segment) {
+  if (cal.minPulseUs < SERVO_PULSE_LIMIT_MIN_US ||
+      cal.maxPulseUs > SERVO_PULSE_LIMIT_MAX_US)
+    return false;
+  if (cal.minPulseUs >= cal.maxPulseUs)
+    return false;
+  if (cal.active != CAL_ANGLE_DEFAULT && (cal.active < 0 || cal.active > 180))
+    return false;
+  if (cal.rest != CAL_ANGLE_DEFAULT && (cal.rest < 0 || cal.rest > 180))
+    return false;
+  // The collision-safety proof of the plans only holds if overrides keep
+  // each segment on the same side of the blocked ranges
+  if (cal.active != CAL_ANGLE_DEFAULT &&
+      !MotionSegmentMap::isAngleCollisionSafe(segment, true, cal.active))
+    return false;
+  if (cal.rest != CAL_ANGLE_DEFAULT &&
+      !MotionSegmentMap::isAngleCollisionSafe(segment, false, cal.rest))
+    return false;
+  return true;
+}
+
+void MotionCalibration::resetDefaults() {
+  for (int b = 0; b < PCA9685_NUM_BOARDS; b++) {
+    for (int c = 0; c < 16; c++) {
+      _channels[b][c].minPulseUs = SERVO_MIN_PULSE_US;
+      _channels[b][c].maxPulseUs = SERVO_MAX_PULSE_US;
+      _channels[b][c].active = CAL_ANGLE_DEFAULT;
+      _channels[b][c].rest = CAL_ANGLE_DEFAULT;
+    }
+  }
+}
+
+void MotionCalibration::begin() {
+  Preferences prefs;
+  StoredCalibration stored;
+
+  resetDefaults();
+  if (!prefs.begin(CAL_NVS_NAMESPACE, true)) {
+    Logger.warning("Calibration: NVS unavailable, using defaults");
+    return;
+  }
+
+  size_t len = prefs.getBytes(CAL_NVS_KEY, &stored, sizeof(stored));
+  prefs.end();
+
+  if (len != sizeof(stored) || stored.version != CAL_LAYOUT_VERSION) {
+    Logger.info("Calibration: no stored data, using defaults");
+    return;
+  }
+
+  int invalid = 0;
+  for (int b = 0; b < PCA9685_NUM_BOARDS; b++) {
+    uint8_t addr = b == 0 ? PCA9685_ADDR_HOURS : PCA9685_ADDR_MINUTES;
+    for (int c = 0; c < 16; c++) {
+      int segment = MotionSegmentMap::getSegment(addr, c);
+      if (_isValid(stored.channels[b][c], segment)) {
+        _channels[b][c] = stored.channels[b][c];
+      } else {
+        invalid++;
+      }
+    }
+  }
+  Logger.info("Calibration loaded (%d invalid channels reset)", invalid);
+}
+
+bool MotionCalibration::save() {
+  Preferences prefs;
+  StoredCalibration stored;
+
+  stored.version = CAL_LAYOUT_VERSION;
+  memcpy(stored.channels, _channels, sizeof(_channels));
+
+  if (!prefs.begin(CAL_NVS_NAMESPACE, false)) {
+    Logger.error("Calibration: cannot open NVS");
+    return false;
+  }
+  bool ok = prefs.putBytes(CAL_NVS_KEY, &stored, sizeof(stored)) ==
+            sizeof(stored);
+  prefs.end();
+
+  if (!ok) {
+    Logger.error("Calibration: NVS write failed");
+  }
+  return ok;
+}
+
+const ServoCalibration &MotionCalibration::get(uint8_t boardAddr,
+                                               uint8_t channel) {
+  int bIdx = _getBoardIndex(boardAddr);
+  if (bIdx < 0 || channel > 15) {
+    bIdx = 0;
+    channel = 0;
+  }
+  return _channels[bIdx][channel];
+}
+
+bool MotionCalibration::set(uint8_t boardAddr, uint8_t channel,
+                            const ServoCalibration &cal) {
+  int bIdx = _getBoardIndex(boardAddr);
+  if (bIdx < 0 || channel > 15 ||
+      !_isValid(cal, MotionSegmentMap::getSegment(boardAddr, channel)))
+    return false;
+  _channels[bIdx][channel] = cal;
+  return true;
+}
+
+int MotionCalibration::resolveAngle(uint8_t boardAddr, uint8_t channel,
+                                    const SegmentConfig &segment, int angle) {
+  const ServoCalibration &cal = get(boardAddr, channel);
+  if (angle == segment.active && cal.active != CAL_ANGLE_DEFAULT)
+    return cal.active;
+  if (angle == segment.rest && cal.rest != CAL_ANGLE_DEFAULT)
+    return cal.rest;
+  return angle;
+}
@@ -0,0 +1,55 @@
+#ifndef MOTION_CALIBRATION_H
+#define MOTION_CALIBRATION_H
+
+#include "config.h"
+#include "motion_segment_map.h"
+#include <Arduino.h>
+
+#define CAL_ANGLE_DEFAULT -1 // Use the segment's default angle
+
+// Calibration of one servo channel
+struct ServoCalibration {
+  uint16_t minPulseUs; // Pulse at 0°
+  uint16_t maxPulseUs; // Pulse at 180°
+  int16_t active;      // Active angle override, CAL_ANGLE_DEFAULT if none
+  int16_t rest;        // Rest angle override, CAL_ANGLE_DEFAULT if none
+};
+
+class MotionCalibration {
+public:
+  MotionCalibration();
+
+  // Load calibration from NVS, defaults if missing or invalid
+  void begin();
+
+  // Persist the current calibration to NVS
+  bool save();
+
+  // Back to SERVO_MIN/MAX_PULSE_US and segment default angles
+  void resetDefaults();
+
+  const ServoCalibration &get(uint8_t boardAddr, uint8_t channel);
+  // False (and nothing changes) for pulse limits or angles out of range,
+  // or angle overrides that would break a collision rule of the channel's
+  // segment (see MotionSegmentMap::isAngleCollisionSafe)
+  bool set(uint8_t boardAddr, uint8_t channel, const ServoCalibration &cal);
+
+  // Apply the channel's active/rest overrides to a segment angle.
+  // Angles other than the segment's active/rest (e.g. intermediate) are
+  // returned unchanged.
+  int resolveAngle(uint8_t boardAddr, uint8_t channel,
+                   const SegmentConfig &segment, int angle);
+
+private:
+  ServoCalibration _channels[PCA9685_NUM_BOARDS][16];
+
+  int _getBoardIndex(uint8_t addr);
+  // Pulse limits, angle range, and the collision rules of the channel's
+  // segment (0 for none)
+  bool _isValid(const ServoCalibration &cal, int segment);
+};
+
+// Global calibration instance
+extern MotionCalibration Calibration;
+
+#endif // MOTION_CALIBRATION_H
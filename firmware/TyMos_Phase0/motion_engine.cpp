@@ -1,15 +1,43 @@
 #include "motion_engine.h"
 #include "core_settings_manager.h"
+#include "motion_calibration.h"
+#include "motion_pose_store.h"
 #include "utils_logger.h"
 
-MotionEngine::MotionEngine(MotionServo *servo, MotionCollision *collision) {
+MotionEngine::MotionEngine(MotionServo *servo, MotionCollision *collision,
+                           MotionScheduler *scheduler) {
   _servo = servo;
   _collision = collision;
+  _scheduler = scheduler;
+
+  // Hold policy: segment 7 is the one 2 and 6 swing past in a collision
+  // sequence, it stays powered a while longer so it is not nudged while
+  // they settle
+  for (int d = 0; d < 4; d++) {
+    uint8_t b, c;
+    MotionSegmentMap::getChannel((DigitPosition)d, 7, b, c);
+    _servo->setHoldTime(b, c, SERVO_HOLD_SEGMENT7_MS);
+  }
 }
 
 void MotionEngine::tick() {
-  // Forward tick to servo manager for idle checks
-  _servo->checkIdle();
+  // Advance running trajectories
+  _scheduler->tick();
+
+  // Idle checks only between transitions: segments parked mid-sequence
+  // (e.g. 2/6 at intermediate) must keep holding their position
+  if (_scheduler->isIdle()) {
+    _servo->checkIdle();
+  }
+}
+
+bool MotionEngine::isBusy() { return !_scheduler->isIdle(); }
+
+void MotionEngine::waitUntilIdle() {
+  while (isBusy()) {
+    tick();
+    delay(1);
+  }
 }
 
 void MotionEngine::resetSequence() {
@@ -17,6 +45,7 @@ void MotionEngine::resetSequence() {
   const int PAUSA_MOVIMENTO = 500;
 
   Logger.info("Starting Reset Sequence...");
+  PoseStore.invalidate();
   Logger.info("------------------------------------------");
   Logger.info("FASE 1: AZZERAMENTO - Tutti a RIPOSO");
   Logger.info("------------------------------------------");
@@ -105,6 +134,7 @@ void MotionEngine::resetSequence() {
 
     // Use updateDigit which handles collision logic for segment 7
     updateDigit(digit, currentNum[digitIdx], num);
+    waitUntilIdle();
     currentNum[digitIdx] = num;
 
     delay(500); // Pause between each number change
@@ -128,16 +158,19 @@ void MotionEngine::resetSequence() {
   // UO: 9 -> 8
   Logger.info("UO -> 8 (da 9)");
   updateDigit(DIGIT_UO, 9, 8);
+  waitUntilIdle();
   delay(500);
 
   // DM: 6 -> 8
   Logger.info("DM -> 8 (da 6)");
   updateDigit(DIGIT_DM, 6, 8);
+  waitUntilIdle();
   delay(500);
 
   // UM: 7 -> 8
   Logger.info("UM -> 8 (da 7)");
   updateDigit(DIGIT_UM, 7, 8);
+  waitUntilIdle();
   delay(500);
 
   // DO is already at 8
@@ -147,38 +180,139 @@ void MotionEngine::resetSequence() {
   Logger.info("==========================================");
 }
 
+void MotionEngine::homeQuick(DisplayState &pose) {
+  Logger.info("Quick homing: all digits to REST in parallel...");
+  PoseStore.invalidate();
+
+  // The start pose is unknown, so targets are written directly and each
+  // step waits for the slowest servo of the step to get there
+  for (int seg = 1; seg <= 7; seg++) {
+    _servo->beginFrame();
+    if (seg == 1)
+      _setSeparatorState(false);
+    for (int d = 0; d < 4; d++) {
+      uint8_t b, c;
+      MotionSegmentMap::getChannel((DigitPosition)d, seg, b, c);
+      SegmentConfig cfg = MotionSegmentMap::getAngles(seg);
+      _servo->setAngle(b, c, Calibration.resolveAngle(b, c, cfg, cfg.rest));
+    }
+    _servo->endFrame();
+    delay(SERVO_HOMING_STEP_MS);
+  }
+
+  for (int d = 0; d < 4; d++) {
+    pose.digits[d] = -1;
+  }
+  pose.separator = false;
+  Logger.info("Quick homing done");
+}
+
 void MotionEngine::updateDigit(DigitPosition digit, int fromNum, int toNum) {
   if (fromNum == toNum)
     return;
 
+  _queueDigit(digit, fromNum, toNum, 0);
+}
+
+uint32_t MotionEngine::_planDisplay(const DisplayState &from,
+                                    const DisplayState &to,
+                                    uint16_t offsets[4]) {
+  // Digits that change share the stagger interval: each one starts its
+  // slots a fraction of the stagger delay after the previous digit
+  int changing = 0;
+  for (int d = 0; d < 4; d++) {
+    if (from.digits[d] != to.digits[d])
+      changing++;
+  }
+
+  SpeedProfile speed = Settings.getSpeed();
+  uint32_t end[4] = {0, 0, 0, 0};
+  uint32_t total = 0;
+  int slot = 0;
+  for (int d = 0; d < 4; d++) {
+    offsets[d] = 0;
+    if (from.digits[d] == to.digits[d])
+      continue;
+    offsets[d] = (slot++ * Settings.getStaggerMs()) / changing;
+    const TransitionPlan &plan =
+        MotionSegmentMap::getTransitionPlan(from.digits[d], to.digits[d]);
+    end[d] = _scheduler->estimatePlanMs((DigitPosition)d, plan, speed,
+                                        offsets[d]);
+    if (end[d] > total)
+      total = end[d];
+  }
+
+  // Hold back the quicker digits so that all of them land together
+  MotionEstimateMove moves[MOTION_MAX_ESTIMATE_MOVES];
+  uint8_t count = 0;
+  for (int d = 0; d < 4; d++) {
+    if (from.digits[d] == to.digits[d])
+      continue;
+    offsets[d] += total - end[d];
+    count = _scheduler->appendPlanEstimate(
+        (DigitPosition)d,
+        MotionSegmentMap::getTransitionPlan(from.digits[d], to.digits[d]),
+        speed, offsets[d], moves, count);
+  }
+
+  if (from.separator != to.separator) {
+    uint8_t b, c;
+    MotionSegmentMap::getChannelSeparator(b, c);
+    uint32_t sep = MotionScheduler::estimateMoveMs(
+        _separatorAngle(b, c, from.separator),
+        _separatorAngle(b, c, to.separator), speed);
+    if (sep > total)
+      total = sep;
+    moves[count].offsetMs = 0;
+    moves[count].durationMs = sep;
+    moves[count].deps = 0;
+    count++;
+  }
+
+  // Starts held back by the supply current budget push the end out
+  uint32_t budgeted = _scheduler->estimateScheduleMs(moves, count);
+  return budgeted > total ? budgeted : total;
+}
+
+uint32_t MotionEngine::estimateDisplayMs(const DisplayState &from,
+                                         const DisplayState &to) {
+  uint16_t offsets[4];
+  return _planDisplay(from, to, offsets);
+}
+
+void MotionEngine::updateDisplay(const DisplayState &from,
+                                 const DisplayState &to) {
+  uint16_t offsets[4];
+  _planDisplay(from, to, offsets);
+
+  for (int d = 0; d < 4; d++) {
+    if (from.digits[d] == to.digits[d])
+      continue;
+    _queueDigit((DigitPosition)d, from.digits[d], to.digits[d], offsets[d]);
+  }
+
+  if (from.separator != to.separator) {
+    uint8_t b, c;
+    MotionSegmentMap::getChannelSeparator(b, c);
+    _scheduler->beginPhase(MOTION_LANE_SEPARATOR);
+    _scheduler->addMove(MOTION_LANE_SEPARATOR, b, c,
+                        _separatorAngle(b, c, from.separator),
+                        _separatorAngle(b, c, to.separator),
+                        Settings.getSpeed());
+  }
+}
+
+void MotionEngine::_queueDigit(DigitPosition digit, int fromNum, int toNum,
+                               uint16_t startOffsetMs) {
   // Check for collision logic
   if (_collision->needsCollisionLogic(fromNum, toNum)) {
-    // Collision Sequence (Blocking) - handles speed internally
-    _collision->executeSequence(digit, fromNum, toNum);
+    // Collision Sequence (Queued phases) - handles speed internally
+    _collision->executeSequence(digit, fromNum, toNum, startOffsetMs);
   } else {
-    // Normal Update (Non-collision)
-    bool segsFrom[7];
-    bool segsTo[7];
-    MotionSegmentMap::getSegmentsForDigit(fromNum, segsFrom);
-    MotionSegmentMap::getSegmentsForDigit(toNum, segsTo);
-
-    SpeedProfile speed = Settings.getSpeed();
-
-    for (int i = 0; i < 7; i++) { // Segments 1-7 (Indices 0-6)
-      int seg = i + 1;
-      if (segsFrom[i] != segsTo[i]) {
-        // State changed
-        uint8_t b, c;
-        MotionSegmentMap::getChannel(digit, seg, b, c);
-
-        SegmentConfig cfg = MotionSegmentMap::getAngles(seg);
-        int startAngle = segsFrom[i] ? cfg.active : cfg.rest;
-        int targetAngle = segsTo[i] ? cfg.active : cfg.rest;
-
-        _servo->moveToAngle(b, c, startAngle, targetAngle, speed);
-        delay(SERVO_STAGGER_DELAY_MS);
-      }
-    }
+    // Normal Update (Non-collision): one phase, segments staggered
+    const TransitionPlan &plan =
+        MotionSegmentMap::getTransitionPlan(fromNum, toNum);
+    _scheduler->addPlan(digit, plan, Settings.getSpeed(), startOffsetMs);
   }
 }
 
@@ -194,17 +328,21 @@ void MotionEngine::_setDigitState(DigitPosition digit, bool active,
   int step = reverseOrder ? -1 : 1;
 
   SpeedProfile speed = Settings.getSpeed();
+  uint16_t offset = 0;
 
+  _scheduler->beginPhase(digit);
   for (int seg = start; seg != (end + step); seg += step) {
     uint8_t b, c;
     MotionSegmentMap::getChannel(digit, seg, b, c);
 
     SegmentConfig cfg = MotionSegmentMap::getAngles(seg);
-    int startAngle = active ? cfg.rest : cfg.active;
-    int targetAngle = active ? cfg.active : cfg.rest;
+    int startAngle =
+        Calibration.resolveAngle(b, c, cfg, active ? cfg.rest : cfg.active);
+    int targetAngle =
+        Calibration.resolveAngle(b, c, cfg, active ? cfg.active : cfg.rest);
 
-    _servo->moveToAngle(b, c, startAngle, targetAngle, speed);
-    delay(SERVO_STAGGER_DELAY_MS);
+    _scheduler->addMove(digit, b, c, startAngle, targetAngle, speed, offset);
+    offset += Settings.getStaggerMs();
   }
 }
 
@@ -221,7 +359,8 @@ void MotionEngine::_setDigitStateSequential(DigitPosition digit, bool active,
     MotionSegmentMap::getChannel(digit, seg, b, c);
 
     SegmentConfig cfg = MotionSegmentMap::getAngles(seg);
-    int target = active ? cfg.active : cfg.rest;
+    int target =
+        Calibration.resolveAngle(b, c, cfg, active ? cfg.active : cfg.rest);
 
     Logger.info("  Segmento %d -> %s (%d)", seg, active ? "ATTIVO" : "RIPOSO",
                 target);
@@ -233,7 +372,16 @@ void MotionEngine::_setDigitStateSequential(DigitPosition digit, bool active,
 void MotionEngine::_setSeparatorState(bool active) {
   uint8_t b, c;
   MotionSegmentMap::getChannelSeparator(b, c);
+  _servo->setAngle(b, c, _separatorAngle(b, c, active));
+}
+
+int MotionEngine::_separatorAngle(uint8_t boardAddr, uint8_t channel,
+                                  bool active) {
+  SegmentConfig cfg;
+  cfg.active = ANGLE_ACTIVE_STANDARD;
+  cfg.rest = ANGLE_REST_STANDARD;
+  cfg.intermediate = -1;
 
-  int target = active ? ANGLE_ACTIVE_STANDARD : ANGLE_REST_STANDARD;
-  _servo->setAngle(b, c, target);
+  return Calibration.resolveAngle(boardAddr, channel, cfg,
+                                  active ? cfg.active : cfg.rest);
 }
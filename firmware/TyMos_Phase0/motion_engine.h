@@ -2,35 +2,68 @@
 #define MOTION_ENGINE_H
 
 #include "motion_collision.h"
+#include "motion_scheduler.h"
 #include "motion_segment_map.h"
 #include "motion_servo.h"
 #include <Arduino.h>
 
+// Glyphs shown on the whole display
+struct DisplayState {
+  int digits[4];  // Indexed by DigitPosition, -1 = unknown (blank)
+  bool separator; // Separator active
+};
+
 class MotionEngine {
 public:
-  MotionEngine(MotionServo *servo, MotionCollision *collision);
+  MotionEngine(MotionServo *servo, MotionCollision *collision,
+               MotionScheduler *scheduler);
 
   // Initial Reset Sequence (Test Iniziale)
   // Phase 1 (REST): DO->UO->SEP->DM->UM (1->7)
   // Phase 2 (ACTIVE): UM->DM->SEP->UO->DO (7->1)
   void resetSequence();
 
-  // Update a digit from one number to another
-  // Handles collision logic if needed, otherwise standard staggered update
+  // Quick homing for an unknown pose (blocking, about 2 s): all digits in
+  // parallel, segments 1->7 of each digit to REST one step apart, like
+  // phase 1 of resetSequence(). Leaves the display blank.
+  void homeQuick(DisplayState &pose);
+
+  // Update a digit from one number to another (Non-blocking)
+  // Handles collision logic if needed, otherwise standard staggered update.
+  // Only queues the moves; they run from tick().
   void updateDigit(DigitPosition getDigit, int fromNum, int toNum);
 
+  // Compose a display-wide change (Non-blocking)
+  // All changed digits and the separator are queued as one schedule that
+  // starts at the same time, with stagger slots interleaved across digits.
+  // Rollover latency is about one digit transition (e.g. 09:59 -> 10:00).
+  // Digits with shorter transitions start later so that every digit
+  // settles together, keeping mixed old/new glyphs on screen briefly.
+  void updateDisplay(const DisplayState &from, const DisplayState &to);
+
+  // Expected time for updateDisplay(from, to) to settle, in ms, from the
+  // plan model at the current speed
+  uint32_t estimateDisplayMs(const DisplayState &from, const DisplayState &to);
+
+  // True while any queued digit transition is still moving
+  bool isBusy();
+
+  // Run tick() until all queued motion has finished (setup-time only)
+  void waitUntilIdle();
+
   // Control Separator
   void setSeparator(bool active);
 
-  // Tick method to be called in loop (for idle management)
+  // Tick method to be called in loop (advances trajectories, idle management)
   void tick();
 
 private:
   MotionServo *_servo;
   MotionCollision *_collision;
+  MotionScheduler *_scheduler;
 
   // Helper to move all segments of a digit to a specific state (Active/Rest)
-  // with strictly ordered staggering (1->7 or 7->1)
+  // with strictly ordered staggering (1->7 or 7->1), queued as one phase
   void _setDigitState(DigitPosition digit, bool active, bool reverseOrder);
 
   // Helper for reset sequence: moves segments one by one with custom delay
@@ -38,8 +71,20 @@ private:
   void _setDigitStateSequential(DigitPosition digit, bool active,
                                 bool reverseOrder, int delayMs);
 
+  // Queue one digit transition, collision sequence if needed
+  void _queueDigit(DigitPosition digit, int fromNum, int toNum,
+                   uint16_t startOffsetMs);
+
+  // Start offsets of each digit for a display-wide change (aligned finish)
+  // Returns the expected settle time of the whole change
+  uint32_t _planDisplay(const DisplayState &from, const DisplayState &to,
+                        uint16_t offsets[4]);
+
   // Helper to set separator state
   void _setSeparatorState(bool active);
+
+  // Separator angle for a state, with calibration overrides
+  int _separatorAngle(uint8_t boardAddr, uint8_t channel, bool active);
 };
 
 #endif // MOTION_ENGINE_H
@@ -0,0 +1,131 @@
+#include "motion_pose_store.h"
+#include "motion_calibration.h"
+#include "utils_logger.h"
+
+#ifdef ARDUINO_ARCH_ESP32
+#include <esp_system.h>
+#endif
+
+#ifndef RTC_NOINIT_ATTR
+#define RTC_NOINIT_ATTR // Host builds: plain RAM, never valid at start
+#endif
+
+// Global instance
+MotionPoseStore PoseStore;
+
+// Record layout
+static const uint32_t POSE_MAGIC = 0x54594D50; // "TYMP"
+static const uint16_t POSE_LAYOUT_VERSION = 1;
+
+enum PoseState : uint8_t { POSE_INVALID, POSE_MOVING, POSE_SETTLED };
+
+struct StoredPose {
+  uint32_t magic;
+  uint16_t version;
+  uint8_t state; // PoseState
+  int8_t digits[4];
+  uint8_t separator;
+  uint32_t calibration; // CRC of the calibration the pose was written with
+  uint32_t checksum;    // CRC of all fields above
+};
+
+// Survives software resets, watchdog and brownout resets, not power loss
+RTC_NOINIT_ATTR static StoredPose rtcPose;
+
+static uint32_t crc32(uint32_t crc, const void *data, size_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+  crc = ~crc;
+  while (len--) {
+    crc ^= *p++;
+    for (int k = 0; k < 8; k++)
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+static uint32_t calibrationCrc() {
+  uint32_t crc = 0;
+  for (int b = 0; b < PCA9685_NUM_BOARDS; b++) {
+    uint8_t addr = b == 0 ? PCA9685_ADDR_HOURS : PCA9685_ADDR_MINUTES;
+    for (uint8_t c = 0; c < 16; c++) {
+      const ServoCalibration &cal = Calibration.get(addr, c);
+      crc = crc32(crc, &cal, sizeof(cal));
+    }
+  }
+  return crc;
+}
+
+static void encode(StoredPose &rec, uint8_t state, const DisplayState &pose) {
+  memset(&rec, 0, sizeof(rec));
+  rec.magic = POSE_MAGIC;
+  rec.version = POSE_LAYOUT_VERSION;
+  rec.state = state;
+  for (int d = 0; d < 4; d++) {
+    rec.digits[d] = (pose.digits[d] < 0 || pose.digits[d] > 9)
+                        ? -1
+                        : (int8_t)pose.digits[d];
+  }
+  rec.separator = pose.separator;
+  rec.calibration = calibrationCrc();
+  rec.checksum = crc32(0, &rec, offsetof(StoredPose, checksum));
+}
+
+// Settled pose from a record, false if it cannot be trusted
+static bool decode(const StoredPose &rec, DisplayState &pose,
+                   const char *source) {
+  if (rec.magic != POSE_MAGIC || rec.version != POSE_LAYOUT_VERSION ||
+      rec.checksum != crc32(0, &rec, offsetof(StoredPose, checksum)))
+    return false;
+
+  if (rec.state != POSE_SETTLED) {
+    Logger.warning("Pose (%s): last move did not finish", source);
+    return false;
+  }
+  if (rec.calibration != calibrationCrc()) {
+    Logger.warning("Pose (%s): calibration changed since it was saved",
+                   source);
+    return false;
+  }
+
+  for (int d = 0; d < 4; d++) {
+    pose.digits[d] = rec.digits[d];
+  }
+  pose.separator = rec.separator != 0;
+  return true;
+}
+
+MotionPoseStore::MotionPoseStore() {}
+
+bool MotionPoseStore::load(DisplayState &pose) {
+#ifdef ARDUINO_ARCH_ESP32
+  // RTC memory holds whatever it powered up with; the checksum would
+  // almost always catch that, but there is nothing to restore anyway
+  if (esp_reset_reason() == ESP_RST_POWERON) {
+    Logger.info("Pose: power-on reset, homing");
+    return false;
+  }
+#endif
+  if (!decode(rtcPose, pose, "RTC memory")) {
+    Logger.info("Pose: no trustworthy record");
+    return false;
+  }
+  Logger.info("Pose restored from RTC memory");
+  return true;
+}
+
+void MotionPoseStore::markMoving(const DisplayState &pose) {
+  _write(POSE_MOVING, pose);
+}
+
+void MotionPoseStore::markSettled(const DisplayState &pose) {
+  _write(POSE_SETTLED, pose);
+}
+
+void MotionPoseStore::invalidate() { _write(POSE_INVALID, DisplayState()); }
+
+void MotionPoseStore::_write(uint8_t state, const DisplayState &pose) {
+  // RAM only: safe on the motion task at every transition
+  StoredPose rec;
+  encode(rec, state, pose);
+  rtcPose = rec;
+}
@@ -0,0 +1,39 @@
+#ifndef MOTION_POSE_STORE_H
+#define MOTION_POSE_STORE_H
+
+#include "motion_engine.h"
+#include <Arduino.h>
+
+// Last commanded display pose, kept across reboots so that boot can skip
+// homing when nothing has moved (OTA reboot, watchdog, brownout). The
+// record lives in RTC no-init memory only: it is written at the start and
+// end of every transition from the motion task, where a flash write would
+// stall both cores. A power cycle loses it and boot homes (~2 s).
+// It is only trusted when its checksum matches, no move was in progress
+// and the servo calibration is the one it was written with.
+class MotionPoseStore {
+public:
+  MotionPoseStore();
+
+  // Restore the last settled pose. False after a power-on reset or if the
+  // record is not trustworthy (home before moving).
+  bool load(DisplayState &pose);
+
+  // A move towards pose has started: until markSettled() the servos are
+  // in between two poses and the record must not be trusted
+  void markMoving(const DisplayState &pose);
+
+  // All servos have reached pose
+  void markSettled(const DisplayState &pose);
+
+  // Forget the pose (e.g. after a manual move or a calibration change)
+  void invalidate();
+
+private:
+  void _write(uint8_t state, const DisplayState &pose);
+};
+
+// Global pose store
+extern MotionPoseStore PoseStore;
+
+#endif // MOTION_POSE_STORE_H
@@ -0,0 +1,14 @@
+#include "motion_power.h"
+
+uint32_t MotionPower::moveCurrentMa(uint32_t runningMs) {
+  return runningMs < SERVO_START_WINDOW_MS ? SERVO_CURRENT_START_MA
+                                           : SERVO_CURRENT_RUN_MA;
+}
+
+uint32_t MotionPower::totalCurrentMa(uint32_t movingMa, uint8_t holding) {
+  return POWER_BASE_MA + movingMa + (uint32_t)holding * SERVO_CURRENT_HOLD_MA;
+}
+
+uint32_t MotionPower::defaultBudgetMa() {
+  return POWER_SUPPLY_MA - POWER_MARGIN_MA;
+}
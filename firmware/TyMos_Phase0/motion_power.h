@@ -0,0 +1,26 @@
+#ifndef MOTION_POWER_H
+#define MOTION_POWER_H
+
+#include "config.h"
+#include <Arduino.h>
+
+// Supply current model. The servos, the ESP32 and both PCA9685 boards run
+// from one 5 V supply. A servo draws most right after it starts (inrush
+// while it accelerates from rest), less while it moves and a little while
+// it holds a position. The per-servo figures in config.h are estimates for
+// an SG90 moving a segment, good enough to keep simultaneous starts away
+// from a brownout.
+class MotionPower {
+public:
+  // Draw of one servo that started moving runningMs ago
+  static uint32_t moveCurrentMa(uint32_t runningMs);
+
+  // Whole clock: base load, plus movingMa for the servos in motion, plus
+  // `holding` powered servos that are not moving
+  static uint32_t totalCurrentMa(uint32_t movingMa, uint8_t holding);
+
+  // Default limit for totalCurrentMa(): the supply minus a safety margin
+  static uint32_t defaultBudgetMa();
+};
+
+#endif // MOTION_POWER_H
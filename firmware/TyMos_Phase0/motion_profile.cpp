@@ -0,0 +1,121 @@
+#include "motion_profile.h"
+#include <math.h>
+
+// Speed profiles as data, indexed by SpeedProfile
+static const MotionProfile MOTION_PROFILES[SPEED_PROFILE_COUNT] = {
+    {"FAST", SPEED_FAST_MAX_VELOCITY, SPEED_FAST_ACCELERATION,
+     SPEED_FAST_JERK},
+    {"NORMAL", SPEED_NORMAL_MAX_VELOCITY, SPEED_NORMAL_ACCELERATION,
+     SPEED_NORMAL_JERK},
+    {"NIGHT", SPEED_NIGHT_MAX_VELOCITY, SPEED_NIGHT_ACCELERATION,
+     SPEED_NIGHT_JERK},
+};
+
+const MotionProfile &MotionTrajectory::getProfile(SpeedProfile speed) {
+  if (speed < 0 || speed >= SPEED_PROFILE_COUNT)
+    return MOTION_PROFILES[SPEED_NIGHT];
+  return MOTION_PROFILES[speed];
+}
+
+float MotionTrajectory::durationFor(SpeedProfile speed, float distance) {
+  MotionTrajectory t;
+  t.plan(getProfile(speed), distance);
+  return t.duration();
+}
+
+void MotionTrajectory::_setPeakVelocity(float v) {
+  _peakVel = v;
+  if (_jerk <= 0) {
+    // Trapezoidal: constant acceleration ramp
+    _jerkTime = 0;
+    _constTime = v / _accel;
+  } else if (v * _jerk >= _accel * _accel) {
+    // S-curve reaching full acceleration
+    _jerkTime = _accel / _jerk;
+    _constTime = v / _accel - _jerkTime;
+  } else {
+    // S-curve too short to reach full acceleration
+    _jerkTime = sqrtf(v / _jerk);
+    _constTime = 0;
+  }
+  _rampTime = 2 * _jerkTime + _constTime;
+  // Ramps are point-symmetric: average velocity is half the peak
+  _rampDist = v * _rampTime / 2;
+}
+
+void MotionTrajectory::plan(const MotionProfile &profile, float distance) {
+  _distance = distance > 0 ? distance : 0;
+  _jerk = profile.jerk;
+  _accel = profile.acceleration;
+
+  if (_distance == 0) {
+    _setPeakVelocity(0);
+    _duration = 0;
+    return;
+  }
+
+  _setPeakVelocity(profile.maxVelocity);
+  if (2 * _rampDist > _distance) {
+    // Short move: find the peak velocity whose ramps cover the distance
+    float lo = 0;
+    float hi = profile.maxVelocity;
+    for (int i = 0; i < 24; i++) {
+      float mid = (lo + hi) / 2;
+      _setPeakVelocity(mid);
+      if (2 * _rampDist > _distance)
+        hi = mid;
+      else
+        lo = mid;
+    }
+    _setPeakVelocity(lo);
+  }
+
+  float cruise = (_distance - 2 * _rampDist) / _peakVel;
+  _duration = 2 * _rampTime + cruise;
+}
+
+float MotionTrajectory::_rampPosition(float t) const {
+  // Accel phase: jerk up, constant accel, jerk down (mirror of the first
+  // part around the phase midpoint)
+  float a = _jerkTime > 0 ? _jerk * _jerkTime : _accel;
+  float firstPart = _jerkTime + _constTime;
+
+  if (t >= _rampTime)
+    return _rampDist;
+
+  if (t > firstPart) {
+    float u = _rampTime - t;
+    return _rampDist - (_peakVel * u - _rampPosition(u));
+  }
+
+  if (t <= _jerkTime)
+    return _jerk * t * t * t / 6;
+
+  float tau = t - _jerkTime;
+  float v1 = _jerk * _jerkTime * _jerkTime / 2;
+  float s1 = _jerk * _jerkTime * _jerkTime * _jerkTime / 6;
+  return s1 + v1 * tau + a * tau * tau / 2;
+}
+
+float MotionTrajectory::positionAt(float t) const {
+  if (t <= 0)
+    return 0;
+  if (t >= _duration)
+    return _distance;
+
+  if (t < _rampTime)
+    return _rampPosition(t);
+
+  float decelStart = _duration - _rampTime;
+  if (t <= decelStart)
+    return _rampDist + _peakVel * (t - _rampTime);
+
+  // Decel phase mirrors the accel phase
+  return _distance - _rampPosition(_duration - t);
+}
+
+float MotionTrajectory::progressAt(float t) const {
+  if (_distance <= 0)
+    return 1;
+  return positionAt(t) / _distance;
+}
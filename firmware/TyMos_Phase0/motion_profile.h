@@ -0,0 +1,53 @@
+#ifndef MOTION_PROFILE_H
+#define MOTION_PROFILE_H
+
+#include "config.h"
+#include <Arduino.h>
+
+// Kinematic limits of a speed profile
+struct MotionProfile {
+  const char *name;
+  float maxVelocity;  // deg/s
+  float acceleration; // deg/s^2
+  float jerk;         // deg/s^3, 0 = trapezoidal
+};
+
+// Time law of one move: symmetric accel / cruise / decel, with jerk-limited
+// (S-curve) ramps when the profile has a jerk limit. Short moves never reach
+// the profile's max velocity.
+class MotionTrajectory {
+public:
+  // Plan a move of `distance` degrees (>= 0) under a profile
+  void plan(const MotionProfile &profile, float distance);
+
+  // Distance covered after t seconds (0..distance)
+  float positionAt(float t) const;
+
+  // Fraction of the move completed after t seconds (0..1)
+  float progressAt(float t) const;
+
+  // Total duration in seconds
+  float duration() const { return _duration; }
+
+  // Look up the limits of a speed profile
+  static const MotionProfile &getProfile(SpeedProfile speed);
+
+  // Duration of a move without planning one (e.g. to predict transitions)
+  static float durationFor(SpeedProfile speed, float distance);
+
+private:
+  float _distance;
+  float _jerk;
+  float _accel;      // Peak acceleration actually used
+  float _peakVel;    // Cruise velocity actually reached
+  float _jerkTime;   // Duration of each jerk ramp
+  float _constTime;  // Constant-acceleration time inside a ramp phase
+  float _rampTime;   // Duration of the accel (and decel) phase
+  float _rampDist;   // Distance covered during the accel phase
+  float _duration;
+
+  void _setPeakVelocity(float v);
+  float _rampPosition(float t) const;
+};
+
+#endif // MOTION_PROFILE_H
@@ -0,0 +1,408 @@
+#include "motion_scheduler.h"
+#include "core_settings_manager.h"
+#include "motion_calibration.h"
+#include "utils_logger.h"
+#include "utils_trace.h"
+
+MotionScheduler::MotionScheduler(MotionServo *servo) {
+  _servo = servo;
+  _budgetMa = MotionPower::defaultBudgetMa();
+  _currentMa = POWER_BASE_MA;
+  _energizedSnapshot = 0;
+  _deferredStarts = 0;
+  clear();
+}
+
+void MotionScheduler::clear() {
+  _activeCount = 0;
+  for (int i = 0; i < MOTION_MAX_MOVES; i++) {
+    _moves[i].used = false;
+    _moves[i].running = false;
+  }
+  for (int l = 0; l < MOTION_MAX_LANES; l++) {
+    _lanes[l].activePhase = 0;
+    _lanes[l].nextPhase = 0;
+    _lanes[l].phaseStart = 0;
+    _lanes[l].doneMask = 0;
+    _lanes[l].buildIndex = 0;
+  }
+}
+
+void MotionScheduler::beginPhase(uint8_t lane) {
+  if (lane >= MOTION_MAX_LANES)
+    return;
+
+  MotionLane &l = _lanes[lane];
+  // An idle lane restarts its clock from the new phase
+  if (l.activePhase == l.nextPhase) {
+    l.phaseStart = millis();
+    l.doneMask = 0;
+    TRACE_EVENT(TRACE_PHASE_BEGIN, lane, l.nextPhase, 0);
+  }
+  l.nextPhase++;
+  l.buildIndex = 0;
+}
+
+bool MotionScheduler::addMove(uint8_t lane, uint8_t boardAddr, uint8_t channel,
+                              int fromAngle, int toAngle, SpeedProfile speed,
+                              uint16_t startOffsetMs, uint16_t deps) {
+  if (lane >= MOTION_MAX_LANES || _lanes[lane].nextPhase == 0)
+    return false;
+  if (_lanes[lane].buildIndex >= MOTION_MAX_PHASE_MOVES) {
+    Logger.error("MotionScheduler: too many moves in one phase");
+    return false;
+  }
+
+  // Zero-length moves are kept so that dependent moves are released
+
+  for (int i = 0; i < MOTION_MAX_MOVES; i++) {
+    MotionMove &m = _moves[i];
+    if (m.used)
+      continue;
+
+    m.used = true;
+    m.running = false;
+    m.deferred = false;
+    m.lane = lane;
+    m.phase = _lanes[lane].nextPhase - 1;
+    m.index = _lanes[lane].buildIndex++;
+    m.deps = deps;
+    m.boardAddr = boardAddr;
+    m.channel = channel;
+    m.startPulse = _servo->angleToPulse(boardAddr, channel, fromAngle);
+    m.targetPulse = _servo->angleToPulse(boardAddr, channel, toAngle);
+    m.startOffsetMs = startOffsetMs;
+    m.startedAt = 0;
+    m.nextStepAt = 0;
+    m.trajectory.plan(MotionTrajectory::getProfile(speed),
+                      abs(toAngle - fromAngle));
+    _activeCount++;
+    return true;
+  }
+
+  Logger.error("MotionScheduler full: dropped move 0x%X ch %d", boardAddr,
+               channel);
+  return false;
+}
+
+void MotionScheduler::_resolvePlanMove(DigitPosition digit, const PlanMove &m,
+                                       uint8_t &boardAddr, uint8_t &channel,
+                                       int &start, int &target) {
+  MotionSegmentMap::getChannel(digit, m.segment, boardAddr, channel);
+
+  // Plans use the default segment angles, apply per-channel overrides
+  SegmentConfig cfg = MotionSegmentMap::getAngles(m.segment);
+  start = Calibration.resolveAngle(boardAddr, channel, cfg, m.startAngle);
+  target = Calibration.resolveAngle(boardAddr, channel, cfg, m.targetAngle);
+}
+
+uint16_t MotionScheduler::_planOffset(const PlanMove &m,
+                                      uint16_t startOffsetMs) {
+  // Dependent moves are timed by their dependencies, not by the offset
+  return m.deps ? 0 : startOffsetMs + m.stagger * Settings.getStaggerMs();
+}
+
+bool MotionScheduler::addPlan(DigitPosition digit, const TransitionPlan &plan,
+                              SpeedProfile speed, uint16_t startOffsetMs) {
+  bool ok = true;
+  beginPhase(digit);
+  for (int i = 0; i < plan.moveCount; i++) {
+    const PlanMove &m = plan.moves[i];
+    uint8_t b, c;
+    int start, target;
+    _resolvePlanMove(digit, m, b, c, start, target);
+    ok &= addMove(digit, b, c, start, target, speed,
+                  _planOffset(m, startOffsetMs), m.deps);
+  }
+  return ok;
+}
+
+uint32_t MotionScheduler::estimateMoveMs(int fromAngle, int toAngle,
+                                         SpeedProfile speed) {
+  // A move is sampled every frame from its start and finishes on the first
+  // sample at or past the end of its trajectory
+  float ms = MotionTrajectory::durationFor(speed, abs(toAngle - fromAngle)) *
+             1000;
+  uint32_t frames = (uint32_t)ceilf(ms / MOTION_FRAME_INTERVAL_MS);
+  return frames * MOTION_FRAME_INTERVAL_MS;
+}
+
+uint32_t MotionScheduler::estimatePlanMs(DigitPosition digit,
+                                         const TransitionPlan &plan,
+                                         SpeedProfile speed,
+                                         uint16_t startOffsetMs) {
+  uint32_t end[PLAN_MAX_MOVES];
+  uint16_t known = 0;
+  uint32_t total = 0;
+
+  // Plans are acyclic, so each pass settles at least one more move
+  for (int pass = 0; pass < plan.moveCount; pass++) {
+    for (int i = 0; i < plan.moveCount; i++) {
+      const PlanMove &m = plan.moves[i];
+      if ((known & (1u << i)) || (m.deps & ~known))
+        continue;
+
+      uint32_t start = _planOffset(m, startOffsetMs);
+      for (int d = 0; d < plan.moveCount; d++) {
+        if ((m.deps & (1u << d)) && end[d] > start)
+          start = end[d];
+      }
+
+      uint8_t b, c;
+      int from, to;
+      _resolvePlanMove(digit, m, b, c, from, to);
+      end[i] = start + estimateMoveMs(from, to, speed);
+      known |= (uint16_t)(1u << i);
+      if (end[i] > total)
+        total = end[i];
+    }
+  }
+  return total;
+}
+
+uint8_t MotionScheduler::appendPlanEstimate(DigitPosition digit,
+                                            const TransitionPlan &plan,
+                                            SpeedProfile speed,
+                                            uint16_t startOffsetMs,
+                                            MotionEstimateMove *moves,
+                                            uint8_t count) {
+  if (count + plan.moveCount > MOTION_MAX_ESTIMATE_MOVES)
+    return count;
+  for (int i = 0; i < plan.moveCount; i++) {
+    const PlanMove &m = plan.moves[i];
+    uint8_t b, c;
+    int from, to;
+    _resolvePlanMove(digit, m, b, c, from, to);
+    MotionEstimateMove &e = moves[count + i];
+    e.offsetMs = _planOffset(m, startOffsetMs);
+    e.durationMs = estimateMoveMs(from, to, speed);
+    e.deps = (uint64_t)m.deps << count;
+  }
+  return count + plan.moveCount;
+}
+
+uint32_t MotionScheduler::estimateScheduleMs(const MotionEstimateMove *moves,
+                                             uint8_t count) {
+  if (count > MOTION_MAX_ESTIMATE_MOVES)
+    count = MOTION_MAX_ESTIMATE_MOVES;
+  uint32_t start[MOTION_MAX_ESTIMATE_MOVES];
+  uint64_t started = 0;
+  uint64_t all = count < 64 ? (1ULL << count) - 1 : ~0ULL;
+  uint8_t energized = _energizedSnapshot.load(std::memory_order_relaxed);
+  uint32_t budgetMa = _budgetMa.load(std::memory_order_relaxed);
+  uint32_t t = 0;
+  uint32_t total = 0;
+
+  // Admission only changes when a move becomes eligible, leaves its start
+  // window or finishes, so time jumps from one such event to the next
+  while (started != all) {
+    uint64_t done = 0;
+    uint32_t movingMa = 0;
+    uint8_t moving = 0;
+    // Servos powered before the change, plus every finished move (bound:
+    // their channel may have been powered already)
+    uint8_t holding = energized;
+    for (int i = 0; i < count; i++) {
+      if (!(started & (1ULL << i)))
+        continue;
+      if (t >= start[i] + moves[i].durationMs) {
+        done |= 1ULL << i;
+        holding++;
+      } else {
+        movingMa += MotionPower::moveCurrentMa(t - start[i]);
+        moving++;
+      }
+    }
+
+    for (int i = 0; i < count; i++) {
+      const MotionEstimateMove &m = moves[i];
+      if ((started & (1ULL << i)) || (m.deps & ~done) || t < m.offsetMs)
+        continue;
+      uint32_t startMa = movingMa + SERVO_CURRENT_START_MA;
+      if (moving > 0 &&
+          MotionPower::totalCurrentMa(startMa, holding) > budgetMa)
+        continue;
+      started |= 1ULL << i;
+      start[i] = t;
+      movingMa = startMa;
+      moving++;
+      if (t + m.durationMs > total)
+        total = t + m.durationMs;
+    }
+
+    // Next event
+    uint32_t next = UINT32_MAX;
+    for (int i = 0; i < count; i++) {
+      uint32_t e[3] = {moves[i].offsetMs, UINT32_MAX, UINT32_MAX};
+      if (started & (1ULL << i)) {
+        e[0] = UINT32_MAX;
+        e[1] = start[i] + SERVO_START_WINDOW_MS;
+        e[2] = start[i] + moves[i].durationMs;
+      }
+      for (int k = 0; k < 3; k++) {
+        if (e[k] > t && e[k] < next)
+          next = e[k];
+      }
+    }
+    if (next == UINT32_MAX)
+      break; // Unsatisfiable dependencies
+    t = next;
+  }
+  return total;
+}
+
+bool MotionScheduler::isIdle() {
+  for (int l = 0; l < MOTION_MAX_LANES; l++) {
+    if (!isLaneIdle(l))
+      return false;
+  }
+  return true;
+}
+
+bool MotionScheduler::isLaneIdle(uint8_t lane) {
+  if (lane >= MOTION_MAX_LANES)
+    return true;
+  return _lanes[lane].activePhase == _lanes[lane].nextPhase;
+}
+
+void MotionScheduler::setCurrentBudgetMa(uint32_t budgetMa) {
+  _budgetMa = budgetMa;
+}
+
+uint32_t MotionScheduler::getCurrentBudgetMa() { return _budgetMa; }
+
+uint32_t MotionScheduler::getCurrentMa() { return _currentMa; }
+
+uint32_t MotionScheduler::getDeferredStarts() { return _deferredStarts; }
+
+uint32_t MotionScheduler::_movingCurrentMa(uint32_t now, uint8_t &moving) {
+  uint32_t ma = 0;
+  moving = 0;
+  for (int i = 0; i < MOTION_MAX_MOVES; i++) {
+    const MotionMove &m = _moves[i];
+    if (m.used && m.running) {
+      ma += MotionPower::moveCurrentMa(now - m.startedAt);
+      moving++;
+    }
+  }
+  return ma;
+}
+
+uint8_t MotionScheduler::_holdingCount(uint8_t moving) {
+  uint8_t energized = _servo->energizedCount();
+  return energized > moving ? energized - moving : 0;
+}
+
+bool MotionScheduler::_phaseDone(uint8_t lane, uint16_t phase) {
+  if (_activeCount == 0)
+    return true;
+  for (int i = 0; i < MOTION_MAX_MOVES; i++) {
+    const MotionMove &m = _moves[i];
+    if (m.used && m.lane == lane && m.phase == phase)
+      return false;
+  }
+  return true;
+}
+
+void MotionScheduler::_advanceLanes(uint32_t now) {
+  // Retire finished phases so the next one can start
+  for (int l = 0; l < MOTION_MAX_LANES; l++) {
+    MotionLane &lane = _lanes[l];
+    while (lane.activePhase != lane.nextPhase &&
+           _phaseDone(l, lane.activePhase)) {
+      TRACE_EVENT(TRACE_PHASE_END, l, lane.activePhase, 0);
+      lane.activePhase++;
+      lane.phaseStart = now;
+      lane.doneMask = 0;
+      if (lane.activePhase != lane.nextPhase)
+        TRACE_EVENT(TRACE_PHASE_BEGIN, l, lane.activePhase, 0);
+    }
+  }
+}
+
+void MotionScheduler::_stepMove(MotionMove &m, uint32_t now) {
+  // Sample the trajectory and interpolate between the calibrated endpoint
+  // counts, so moves resolve to single PWM counts instead of whole degrees
+  // (a zero-length move just writes its target once)
+  float t = (now - m.startedAt) / 1000.0f;
+  bool done = t >= m.trajectory.duration();
+
+  uint16_t pulse = m.targetPulse;
+  if (!done) {
+    int delta = (int)m.targetPulse - (int)m.startPulse;
+    pulse = m.startPulse + (int)lroundf(delta * m.trajectory.progressAt(t));
+  }
+  _servo->setPulse(m.boardAddr, m.channel, pulse);
+
+  if (done) {
+    TRACE_EVENT(TRACE_MOVE_END, m.lane, m.boardAddr << 8 | m.channel, 0);
+    _lanes[m.lane].doneMask |= (uint16_t)(1u << m.index);
+    m.used = false;
+    m.running = false;
+    _activeCount--;
+  } else {
+    m.nextStepAt = now + MOTION_FRAME_INTERVAL_MS;
+  }
+}
+
+void MotionScheduler::tick() {
+  uint32_t now = millis();
+  _advanceLanes(now);
+
+  if (_activeCount == 0) {
+    _currentMa = MotionPower::totalCurrentMa(0, _holdingCount(0));
+    _energizedSnapshot.store(_servo->energizedCount(),
+                             std::memory_order_relaxed);
+    return;
+  }
+
+  // Draw of what is already moving: a start is admitted only if its
+  // inrush still fits the budget (running moves never draw more later)
+  uint8_t moving;
+  uint32_t movingMa = _movingCurrentMa(now, moving);
+
+  // All steps of this tick go out as one burst per board
+  _servo->beginFrame();
+  for (int i = 0; i < MOTION_MAX_MOVES; i++) {
+    MotionMove &m = _moves[i];
+    if (!m.used)
+      continue;
+
+    const MotionLane &lane = _lanes[m.lane];
+    if (!m.running) {
+      if (m.phase != lane.activePhase || (m.deps & ~lane.doneMask) ||
+          now - lane.phaseStart < m.startOffsetMs)
+        continue;
+      uint32_t startMa = movingMa + SERVO_CURRENT_START_MA;
+      if (moving > 0 &&
+          MotionPower::totalCurrentMa(startMa, _holdingCount(moving + 1)) >
+              _budgetMa) {
+        if (!m.deferred) {
+          m.deferred = true;
+          _deferredStarts++;
+        }
+        continue;
+      }
+      movingMa = startMa;
+      moving++;
+      m.running = true;
+      m.startedAt = now;
+      m.nextStepAt = now;
+      TRACE_EVENT(TRACE_MOVE_START, m.lane, m.boardAddr << 8 | m.channel,
+                  (uint32_t)(m.trajectory.duration() * 1000));
+    }
+
+    if ((int32_t)(now - m.nextStepAt) >= 0) {
+      _stepMove(m, now);
+    }
+  }
+  _servo->endFrame();
+  movingMa = _movingCurrentMa(now, moving);
+  _currentMa = MotionPower::totalCurrentMa(movingMa, _holdingCount(moving));
+  _energizedSnapshot.store(_servo->energizedCount(),
+                           std::memory_order_relaxed);
+
+  // Phases that just finished hand over to the next one without waiting
+  // for another tick
+  _advanceLanes(now);
+}
@@ -0,0 +1,149 @@
+#ifndef MOTION_SCHEDULER_H
+#define MOTION_SCHEDULER_H
+
+#include "config.h"
+#include "motion_power.h"
+#include "motion_profile.h"
+#include "motion_segment_map.h"
+#include "motion_servo.h"
+#include <Arduino.h>
+#include <atomic>
+
+// Scheduler capacity
+#define MOTION_MAX_LANES 5      // One lane per digit (DO, UO, DM, UM) + SEP
+#define MOTION_LANE_SEPARATOR 4
+#define MOTION_MAX_MOVES 48  // Pending + running moves across all lanes
+#define MOTION_MAX_PHASE_MOVES 16 // Moves per phase (dependency mask width)
+
+// A single servo trajectory owned by the scheduler
+struct MotionMove {
+  bool used;
+  bool running;
+  bool deferred;        // Held back by the current budget at least once
+  uint8_t lane;
+  uint16_t phase;       // Phase sequence number inside the lane
+  uint8_t index;        // Position inside the phase (dependency bit)
+  uint16_t deps;        // Moves of the same phase that must finish first
+  uint8_t boardAddr;
+  uint8_t channel;
+  uint16_t startPulse;    // 12-bit counts from the channel's calibration
+  uint16_t targetPulse;
+  uint16_t startOffsetMs; // Delay from phase start (stagger)
+  uint32_t startedAt;     // millis() when the move started running
+  uint32_t nextStepAt;
+  MotionTrajectory trajectory;
+};
+
+// One move of a schedule being estimated (see estimateScheduleMs)
+struct MotionEstimateMove {
+  uint32_t offsetMs;   // Earliest start
+  uint32_t durationMs; // Running time, whole frames
+  uint64_t deps;       // Moves (by index) that must finish first
+};
+
+// A display-wide change: four digit plans and the separator
+#define MOTION_MAX_ESTIMATE_MOVES (4 * PLAN_MAX_MOVES + 1)
+
+// Per-lane phase bookkeeping
+struct MotionLane {
+  uint16_t activePhase; // Phase currently executing
+  uint16_t nextPhase;   // Number of phases queued so far
+  uint32_t phaseStart;  // millis() when activePhase started
+  uint16_t doneMask;    // Finished moves of activePhase
+  uint8_t buildIndex;   // Moves added so far to the last opened phase
+};
+
+class MotionScheduler {
+public:
+  MotionScheduler(MotionServo *servo);
+
+  // Open a new phase on a lane. Moves added afterwards belong to it and
+  // become eligible once every move of the previous phase has finished.
+  void beginPhase(uint8_t lane);
+
+  // Queue a move in the lane's last opened phase. Moves are numbered in
+  // the order they are added (0, 1, ...); deps is a mask of those numbers
+  // that must finish before this move starts. startOffsetMs delays the
+  // move relative to the phase start.
+  // Returns false if the scheduler is full.
+  bool addMove(uint8_t lane, uint8_t boardAddr, uint8_t channel, int fromAngle,
+               int toAngle, SpeedProfile speed, uint16_t startOffsetMs = 0,
+               uint16_t deps = 0);
+
+  // Queue a precompiled transition plan on the digit's lane as one phase,
+  // keeping the plan's dependency graph. startOffsetMs shifts every
+  // independent move of the plan.
+  // Returns false if the scheduler is full.
+  bool addPlan(DigitPosition digit, const TransitionPlan &plan,
+               SpeedProfile speed, uint16_t startOffsetMs = 0);
+
+  // Expected time from now until the last move of a plan has settled, if
+  // it were queued on an idle lane. Follows the same offsets, dependencies
+  // and frame sampling as tick().
+  uint32_t estimatePlanMs(DigitPosition digit, const TransitionPlan &plan,
+                          SpeedProfile speed, uint16_t startOffsetMs = 0);
+
+  // Expected running time of a single move, rounded up to whole frames
+  static uint32_t estimateMoveMs(int fromAngle, int toAngle,
+                                 SpeedProfile speed);
+
+  // Append the moves of a plan to an estimate, as addPlan() would queue
+  // them. Returns the new count (unchanged if they do not fit).
+  uint8_t appendPlanEstimate(DigitPosition digit, const TransitionPlan &plan,
+                             SpeedProfile speed, uint16_t startOffsetMs,
+                             MotionEstimateMove *moves, uint8_t count);
+
+  // Expected time from now until a set of moves has settled if it were
+  // queued on idle lanes, with starts held back by the current budget the
+  // way tick() does (event-driven, no per-tick simulation). Reads the
+  // energized count published by the last tick(), so the control core
+  // can call it while the motion task runs.
+  uint32_t estimateScheduleMs(const MotionEstimateMove *moves, uint8_t count);
+
+  // Advance all active trajectories (non-blocking, call from loop)
+  void tick();
+
+  // Drop every queued and running move; servos keep their last pulse
+  void clear();
+
+  // True when no move is queued or running
+  bool isIdle();
+  bool isLaneIdle(uint8_t lane);
+
+  // Supply current budget (MotionPower model). A move whose start would
+  // take the estimate past it waits for running moves to calm down; it
+  // always starts if nothing else is moving.
+  void setCurrentBudgetMa(uint32_t budgetMa);
+  uint32_t getCurrentBudgetMa();
+
+  // Estimated supply current as of the last tick()
+  uint32_t getCurrentMa();
+
+  // Moves that had to wait for the budget since boot
+  uint32_t getDeferredStarts();
+
+private:
+  MotionServo *_servo;
+  MotionMove _moves[MOTION_MAX_MOVES];
+  MotionLane _lanes[MOTION_MAX_LANES];
+  uint8_t _activeCount;
+  std::atomic<uint32_t> _budgetMa;
+  // Servos powered as of the last tick(), for estimates from other tasks
+  std::atomic<uint8_t> _energizedSnapshot;
+  uint32_t _currentMa;
+  uint32_t _deferredStarts;
+
+  void _resolvePlanMove(DigitPosition digit, const PlanMove &m,
+                        uint8_t &boardAddr, uint8_t &channel, int &start,
+                        int &target);
+  static uint16_t _planOffset(const PlanMove &m, uint16_t startOffsetMs);
+  bool _phaseDone(uint8_t lane, uint16_t phase);
+  void _advanceLanes(uint32_t now);
+  void _stepMove(MotionMove &move, uint32_t now);
+
+  // Draw of the running moves, and how many there are
+  uint32_t _movingCurrentMa(uint32_t now, uint8_t &moving);
+  uint8_t _holdingCount(uint8_t moving);
+};
+
+#endif // MOTION_SCHEDULER_H
@@ -1,5 +1,319 @@
 #include "motion_segment_map.h"
 
+// ============================================================================
+// Compile-time tables
+// ============================================================================
+
+namespace {
+
+struct SegmentAngles {
+  uint8_t active;
+  uint8_t rest;
+  int16_t intermediate; // -1 if none
+};
+
+// Standard: Active 70, Rest 165
+// Inverted (3, 6): Active 100, Rest 5
+// 2 and 6 have an intermediate position to clear segment 7
+constexpr SegmentAngles SEGMENT_ANGLES[7] = {
+    {ANGLE_ACTIVE_STANDARD, ANGLE_REST_STANDARD, -1}, // Segment 1
+    {ANGLE_ACTIVE_STANDARD, ANGLE_REST_STANDARD,
+     ANGLE_INTERMEDIATE_STANDARD},                    // Segment 2
+    {ANGLE_ACTIVE_INVERTED, ANGLE_REST_INVERTED, -1}, // Segment 3 (Inv)
+    {ANGLE_ACTIVE_STANDARD, ANGLE_REST_STANDARD, -1}, // Segment 4
+    {ANGLE_ACTIVE_STANDARD, ANGLE_REST_STANDARD, -1}, // Segment 5
+    {ANGLE_ACTIVE_INVERTED, ANGLE_REST_INVERTED,
+     ANGLE_INTERMEDIATE_INVERTED},                    // Segment 6 (Inv)
+    {ANGLE_ACTIVE_STANDARD, ANGLE_REST_STANDARD, -1}, // Segment 7
+};
+
+// Mapping from architecture.rtf section 4.5:
+// | Cifra | Segmenti Attivi      |
+// |-------|----------------------|
+// | 0     | 1, 2, 3, 4, 5, 6     |
+// | 1     | 5, 6                 |
+// | 2     | 1, 2, 4, 5, 7        |
+// | 3     | 1, 4, 5, 6, 7        |
+// | 4     | 3, 5, 6, 7           |
+// | 5     | 1, 3, 4, 6, 7        |
+// | 6     | 1, 2, 3, 4, 6, 7     |
+// | 7     | 4, 5, 6              |
+// | 8     | 1, 2, 3, 4, 5, 6, 7  |
+// | 9     | 1, 3, 4, 5, 6, 7     |
+// Index 10 is the blank glyph (all rest), used for unknown numbers
+constexpr uint8_t GLYPH_BLANK = 10;
+constexpr uint8_t GLYPH_COUNT = 11;
+constexpr uint8_t DIGIT_MASKS[GLYPH_COUNT] = {
+    0x3F, // 0: 1, 2, 3, 4, 5, 6
+    0x30, // 1: 5, 6
+    0x5B, // 2: 1, 2, 4, 5, 7
+    0x79, // 3: 1, 4, 5, 6, 7
+    0x74, // 4: 3, 5, 6, 7
+    0x6D, // 5: 1, 3, 4, 6, 7
+    0x6F, // 6: 1, 2, 3, 4, 6, 7
+    0x38, // 7: 4, 5, 6
+    0x7F, // 8: all
+    0x7D, // 9: 1, 3, 4, 5, 6, 7
+    0x00, // blank
+};
+
+constexpr uint8_t segmentAngle(int seg, bool active) {
+  return active ? SEGMENT_ANGLES[seg - 1].active : SEGMENT_ANGLES[seg - 1].rest;
+}
+
+constexpr bool segmentOn(uint8_t mask, int seg) {
+  return (mask & SEGMENT_BIT(seg)) != 0;
+}
+
+// Collision rules: while segment `mover` travels, segment `other` must stay
+// outside [blockMin, blockMax]. Segment 7 sweeps the space 2 and 6 occupy
+// near their active position; at intermediate or rest they are clear.
+struct CollisionRule {
+  uint8_t mover;
+  uint8_t other;
+  uint8_t blockMin;
+  uint8_t blockMax;
+};
+
+constexpr CollisionRule COLLISION_RULES[] = {
+    {7, 2, ANGLE_ACTIVE_STANDARD, ANGLE_INTERMEDIATE_STANDARD - 1},
+    {7, 6, ANGLE_INTERMEDIATE_INVERTED + 1, ANGLE_ACTIVE_INVERTED},
+};
+constexpr int COLLISION_RULE_COUNT =
+    sizeof(COLLISION_RULES) / sizeof(COLLISION_RULES[0]);
+
+constexpr bool inBlock(const CollisionRule &rule, uint8_t angle) {
+  return angle >= rule.blockMin && angle <= rule.blockMax;
+}
+
+// True if a move from a to b passes through the blocked range
+constexpr bool sweepsBlock(const CollisionRule &rule, uint8_t a, uint8_t b) {
+  uint8_t lo = a < b ? a : b;
+  uint8_t hi = a < b ? b : a;
+  return lo <= rule.blockMax && hi >= rule.blockMin;
+}
+
+constexpr bool isMoverInPlan(uint8_t seg, uint8_t fromMask, uint8_t toMask) {
+  for (int r = 0; r < COLLISION_RULE_COUNT; r++) {
+    const CollisionRule &rule = COLLISION_RULES[r];
+    if (rule.other == seg &&
+        segmentOn(fromMask, rule.mover) != segmentOn(toMask, rule.mover))
+      return true;
+  }
+  return false;
+}
+
+constexpr void addMove(TransitionPlan &plan, uint8_t seg, uint8_t start,
+                       uint8_t target) {
+  PlanMove &m = plan.moves[plan.moveCount++];
+  m.segment = seg;
+  m.stagger = 0;
+  m.startAngle = start;
+  m.targetAngle = target;
+  m.deps = 0;
+}
+
+// Derive the dependency DAG of a plan from the collision rules:
+// - moves of the same segment run in order
+// - a move leaving a blocked range must finish before the mover starts
+// - a move entering a blocked range waits for the mover to finish
+constexpr void addDependencies(TransitionPlan &plan) {
+  for (int i = 0; i < plan.moveCount; i++) {
+    PlanMove &m = plan.moves[i];
+    for (int j = 0; j < i; j++) {
+      if (plan.moves[j].segment == m.segment)
+        m.deps |= (uint16_t)(1u << j);
+    }
+  }
+
+  for (int r = 0; r < COLLISION_RULE_COUNT; r++) {
+    const CollisionRule &rule = COLLISION_RULES[r];
+    for (int i = 0; i < plan.moveCount; i++) {
+      if (plan.moves[i].segment != rule.mover)
+        continue;
+      for (int j = 0; j < plan.moveCount; j++) {
+        PlanMove &o = plan.moves[j];
+        if (o.segment != rule.other ||
+            !sweepsBlock(rule, o.startAngle, o.targetAngle))
+          continue;
+        if (inBlock(rule, o.startAngle)) {
+          plan.moves[i].deps |= (uint16_t)(1u << j);
+        } else {
+          o.deps |= (uint16_t)(1u << i);
+        }
+      }
+    }
+  }
+}
+
+// Build the move plan for one transition.
+// Every changed segment moves once, from the source glyph to the target
+// glyph. When segment 7 toggles, 2 and 6 park first (Intermediate if their
+// final state is Active, Rest otherwise) and reach their final position
+// after 7. Ordering comes only from addDependencies(): moves without
+// dependencies start together, staggered 1 -> 7.
+constexpr TransitionPlan buildPlan(uint8_t from, uint8_t to) {
+  TransitionPlan plan{};
+  uint8_t fromMask = DIGIT_MASKS[from];
+  uint8_t toMask = DIGIT_MASKS[to];
+  plan.collision = segmentOn(fromMask, 7) != segmentOn(toMask, 7);
+
+  for (uint8_t seg = 1; seg <= 7; seg++) {
+    bool wasOn = segmentOn(fromMask, seg);
+    bool isOn = segmentOn(toMask, seg);
+    uint8_t start = segmentAngle(seg, wasOn);
+    uint8_t target = segmentAngle(seg, isOn);
+
+    if (SEGMENT_ANGLES[seg - 1].intermediate >= 0 &&
+        isMoverInPlan(seg, fromMask, toMask)) {
+      uint8_t parked = isOn ? (uint8_t)SEGMENT_ANGLES[seg - 1].intermediate
+                            : segmentAngle(seg, false);
+      if (start != parked)
+        addMove(plan, seg, start, parked);
+      if (parked != target)
+        addMove(plan, seg, parked, target);
+    } else if (wasOn != isOn) {
+      addMove(plan, seg, start, target);
+    }
+  }
+
+  addDependencies(plan);
+
+  uint8_t stagger = 0;
+  for (int i = 0; i < plan.moveCount; i++) {
+    if (plan.moves[i].deps == 0)
+      plan.moves[i].stagger = stagger++;
+  }
+  return plan;
+}
+
+struct TransitionTable {
+  TransitionPlan plans[GLYPH_COUNT][GLYPH_COUNT];
+};
+
+constexpr TransitionTable buildTable() {
+  TransitionTable table{};
+  for (uint8_t from = 0; from < GLYPH_COUNT; from++) {
+    for (uint8_t to = 0; to < GLYPH_COUNT; to++) {
+      table.plans[from][to] = buildPlan(from, to);
+    }
+  }
+  return table;
+}
+
+constexpr TransitionTable TRANSITIONS = buildTable();
+
+// ----------------------------------------------------------------------------
+// Build-time checks
+// ----------------------------------------------------------------------------
+
+// All moves that must finish before move i starts (transitive)
+constexpr uint16_t predecessors(const TransitionPlan &plan, int i) {
+  uint16_t mask = plan.moves[i].deps;
+  for (int pass = 0; pass < PLAN_MAX_MOVES; pass++) {
+    for (int j = 0; j < plan.moveCount; j++) {
+      if (mask & (1u << j))
+        mask |= plan.moves[j].deps;
+    }
+  }
+  return mask;
+}
+
+// The dependency graph has no cycle
+constexpr bool planIsAcyclic(const TransitionPlan &plan) {
+  for (int i = 0; i < plan.moveCount; i++) {
+    if (predecessors(plan, i) & (1u << i))
+      return false;
+  }
+  return true;
+}
+
+// Each segment goes from the source glyph angle to the target glyph angle
+// through a chain of ordered moves
+constexpr bool planIsConsistent(uint8_t from, uint8_t to) {
+  const TransitionPlan &plan = TRANSITIONS.plans[from][to];
+  for (int seg = 1; seg <= 7; seg++) {
+    uint8_t angle = segmentAngle(seg, segmentOn(DIGIT_MASKS[from], seg));
+    int last = -1;
+    for (int i = 0; i < plan.moveCount; i++) {
+      const PlanMove &m = plan.moves[i];
+      if (m.segment != seg)
+        continue;
+      if (last >= 0 && !(m.deps & (1u << last)))
+        return false;
+      if (m.startAngle != angle || m.startAngle == m.targetAngle)
+        return false;
+      angle = m.targetAngle;
+      last = i;
+    }
+    if (angle != segmentAngle(seg, segmentOn(DIGIT_MASKS[to], seg)))
+      return false;
+  }
+  return true;
+}
+
+// While a mover travels, every other segment of its rules is outside the
+// blocked range: parked before it starts, and neither moving through the
+// range concurrently nor entering it before it finishes
+constexpr bool planIsCollisionSafe(uint8_t from, uint8_t to) {
+  const TransitionPlan &plan = TRANSITIONS.plans[from][to];
+  for (int r = 0; r < COLLISION_RULE_COUNT; r++) {
+    const CollisionRule &rule = COLLISION_RULES[r];
+    for (int i = 0; i < plan.moveCount; i++) {
+      if (plan.moves[i].segment != rule.mover)
+        continue;
+      uint16_t before = predecessors(plan, i);
+
+      // Position of `other` when the mover starts
+      uint8_t angle =
+          segmentAngle(rule.other, segmentOn(DIGIT_MASKS[from], rule.other));
+      for (int j = 0; j < plan.moveCount; j++) {
+        const PlanMove &o = plan.moves[j];
+        if (o.segment != rule.other)
+          continue;
+        if (before & (1u << j)) {
+          angle = o.targetAngle;
+        } else if (!(predecessors(plan, j) & (1u << i)) &&
+                   sweepsBlock(rule, o.startAngle, o.targetAngle)) {
+          return false; // Concurrent move through the blocked range
+        }
+      }
+      if (inBlock(rule, angle))
+        return false;
+    }
+  }
+  return true;
+}
+
+constexpr bool allPlansValid() {
+  for (uint8_t from = 0; from < GLYPH_COUNT; from++) {
+    for (uint8_t to = 0; to < GLYPH_COUNT; to++) {
+      if (!planIsAcyclic(TRANSITIONS.plans[from][to]) ||
+          !planIsConsistent(from, to) || !planIsCollisionSafe(from, to))
+        return false;
+    }
+  }
+  return true;
+}
+
+static_assert(allPlansValid(), "Invalid digit transition plan");
+static_assert(TRANSITIONS.plans[8][8].moveCount == 0,
+              "Same digit must not move");
+static_assert(!TRANSITIONS.plans[1][7].collision &&
+                  TRANSITIONS.plans[1][7].moveCount == 1,
+              "1 -> 7 only raises segment 4");
+static_assert(TRANSITIONS.plans[0][8].collision &&
+                  TRANSITIONS.plans[0][8].moveCount == 5 &&
+                  TRANSITIONS.plans[0][8].moves[4].segment == 7 &&
+                  TRANSITIONS.plans[0][8].moves[4].deps == 0x05,
+              "0 -> 8 parks 2/6 before raising 7");
+
+} // namespace
+
+// ============================================================================
+// MotionSegmentMap
+// ============================================================================
+
 void MotionSegmentMap::getChannel(DigitPosition digit, int segment,
                                   uint8_t &boardAddr, uint8_t &channel) {
   // Segments are 1-7. Map to 0-6.
@@ -37,156 +351,62 @@ void MotionSegmentMap::getChannelSeparator(uint8_t &boardAddr,
   channel = 15;
 }
 
+int MotionSegmentMap::getSegment(uint8_t boardAddr, uint8_t channel) {
+  if (boardAddr != PCA9685_ADDR_HOURS && boardAddr != PCA9685_ADDR_MINUTES)
+    return 0;
+  // Digits use channels 0-6 and 8-14 of each board (see getChannel)
+  int segIdx = channel % 8;
+  if (channel > 15 || segIdx > 6)
+    return 0;
+  return segIdx + 1;
+}
+
 SegmentConfig MotionSegmentMap::getAngles(int segment) {
   SegmentConfig cfg;
-  cfg.intermediate = -1; // Default none
-
-  // Standard: Active 70, Rest 165
-  // Inverted (3, 6): Active 100, Rest 5
-
-  // Segment 1
-  if (segment == 1) {
-    cfg.active = ANGLE_ACTIVE_STANDARD;
-    cfg.rest = ANGLE_REST_STANDARD;
-    cfg.intermediate = -1;
-  }
-  // Segment 2
-  else if (segment == 2) {
-    cfg.active = ANGLE_ACTIVE_STANDARD;
-    cfg.rest = ANGLE_REST_STANDARD;
-    cfg.intermediate = ANGLE_INTERMEDIATE_STANDARD; // Collision inter
-  }
-  // Segment 3 (Inv)
-  else if (segment == 3) {
-    cfg.active = ANGLE_ACTIVE_INVERTED;
-    cfg.rest = ANGLE_REST_INVERTED;
-    cfg.intermediate = -1;
-  }
-  // Segment 4
-  else if (segment == 4) {
-    cfg.active = ANGLE_ACTIVE_STANDARD;
-    cfg.rest = ANGLE_REST_STANDARD;
-    cfg.intermediate = -1;
-  }
-  // Segment 5
-  else if (segment == 5) {
-    cfg.active = ANGLE_ACTIVE_STANDARD;
-    cfg.rest = ANGLE_REST_STANDARD;
-    cfg.intermediate = -1;
-  }
-  // Segment 6 (Inv)
-  else if (segment == 6) {
-    cfg.active = ANGLE_ACTIVE_INVERTED;
-    cfg.rest = ANGLE_REST_INVERTED;
-    cfg.intermediate = ANGLE_INTERMEDIATE_INVERTED; // Collision inter
-  }
-  // Segment 7
-  else if (segment == 7) {
-    cfg.active = ANGLE_ACTIVE_STANDARD;
-    cfg.rest = ANGLE_REST_STANDARD;
-    cfg.intermediate = -1;
-  } else {
+  if (segment < 1 || segment > 7) {
     // Fallback
     cfg.active = ANGLE_ACTIVE_STANDARD;
     cfg.rest = ANGLE_REST_STANDARD;
+    cfg.intermediate = -1;
+    return cfg;
   }
+
+  const SegmentAngles &angles = SEGMENT_ANGLES[segment - 1];
+  cfg.active = angles.active;
+  cfg.rest = angles.rest;
+  cfg.intermediate = angles.intermediate;
   return cfg;
 }
 
+bool MotionSegmentMap::isAngleCollisionSafe(int segment, bool active,
+                                            int angle) {
+  for (int r = 0; r < COLLISION_RULE_COUNT; r++) {
+    const CollisionRule &rule = COLLISION_RULES[r];
+    if (rule.other != segment)
+      continue;
+    bool blocked = angle >= rule.blockMin && angle <= rule.blockMax;
+    if (blocked != active)
+      return false;
+  }
+  return true;
+}
+
+uint8_t MotionSegmentMap::getDigitMask(int number) {
+  if (number < 0 || number > 9)
+    return DIGIT_MASKS[GLYPH_BLANK];
+  return DIGIT_MASKS[number];
+}
+
 void MotionSegmentMap::getSegmentsForDigit(int number, bool *buffer) {
-  // Reset buffer
+  // Buffer is 0-indexed (Seg 1 is index 0, Seg 7 is index 6)
+  uint8_t mask = getDigitMask(number);
   for (int i = 0; i < 7; i++)
-    buffer[i] = false;
+    buffer[i] = (mask >> i) & 1;
+}
 
-  // Buffer is 0-indexed (Seg 1 is index 0, Seg 7 is index 6)
-  // Mapping from architecture.rtf section 4.5:
-  // | Cifra | Segmenti Attivi      |
-  // |-------|----------------------|
-  // | 0     | 1, 2, 3, 4, 5, 6     |
-  // | 1     | 5, 6                 |
-  // | 2     | 1, 2, 4, 5, 7        |
-  // | 3     | 1, 4, 5, 6, 7        |
-  // | 4     | 3, 5, 6, 7           |
-  // | 5     | 1, 3, 4, 6, 7        |
-  // | 6     | 1, 2, 3, 4, 6, 7     |
-  // | 7     | 4, 5, 6              |
-  // | 8     | 1, 2, 3, 4, 5, 6, 7  |
-  // | 9     | 1, 3, 4, 5, 6, 7     |
-
-  switch (number) {
-  case 0:
-    // Segmenti: 1, 2, 3, 4, 5, 6
-    buffer[0] = true; // Seg 1
-    buffer[1] = true; // Seg 2
-    buffer[2] = true; // Seg 3
-    buffer[3] = true; // Seg 4
-    buffer[4] = true; // Seg 5
-    buffer[5] = true; // Seg 6
-    break;
-  case 1:
-    // Segmenti: 5, 6
-    buffer[4] = true; // Seg 5
-    buffer[5] = true; // Seg 6
-    break;
-  case 2:
-    // Segmenti: 1, 2, 4, 5, 7
-    buffer[0] = true; // Seg 1
-    buffer[1] = true; // Seg 2
-    buffer[3] = true; // Seg 4
-    buffer[4] = true; // Seg 5
-    buffer[6] = true; // Seg 7
-    break;
-  case 3:
-    // Segmenti: 1, 4, 5, 6, 7
-    buffer[0] = true; // Seg 1
-    buffer[3] = true; // Seg 4
-    buffer[4] = true; // Seg 5
-    buffer[5] = true; // Seg 6
-    buffer[6] = true; // Seg 7
-    break;
-  case 4:
-    // Segmenti: 3, 5, 6, 7
-    buffer[2] = true; // Seg 3
-    buffer[4] = true; // Seg 5
-    buffer[5] = true; // Seg 6
-    buffer[6] = true; // Seg 7
-    break;
-  case 5:
-    // Segmenti: 1, 3, 4, 6, 7
-    buffer[0] = true; // Seg 1
-    buffer[2] = true; // Seg 3
-    buffer[3] = true; // Seg 4
-    buffer[5] = true; // Seg 6
-    buffer[6] = true; // Seg 7
-    break;
-  case 6:
-    // Segmenti: 1, 2, 3, 4, 6, 7
-    buffer[0] = true; // Seg 1
-    buffer[1] = true; // Seg 2
-    buffer[2] = true; // Seg 3
-    buffer[3] = true; // Seg 4
-    buffer[5] = true; // Seg 6
-    buffer[6] = true; // Seg 7
-    break;
-  case 7:
-    // Segmenti: 4, 5, 6
-    buffer[3] = true; // Seg 4
-    buffer[4] = true; // Seg 5
-    buffer[5] = true; // Seg 6
-    break;
-  case 8:
-    // Segmenti: 1, 2, 3, 4, 5, 6, 7 (tutti)
-    for (int i = 0; i < 7; i++)
-      buffer[i] = true;
-    break;
-  case 9:
-    // Segmenti: 1, 3, 4, 5, 6, 7
-    buffer[0] = true; // Seg 1
-    buffer[2] = true; // Seg 3
-    buffer[3] = true; // Seg 4
-    buffer[4] = true; // Seg 5
-    buffer[5] = true; // Seg 6
-    buffer[6] = true; // Seg 7
-    break;
-  }
+const TransitionPlan &MotionSegmentMap::getTransitionPlan(int fromNum,
+                                                          int toNum) {
+  uint8_t from = (fromNum < 0 || fromNum > 9) ? GLYPH_BLANK : fromNum;
+  uint8_t to = (toNum < 0 || toNum > 9) ? GLYPH_BLANK : toNum;
+  return TRANSITIONS.plans[from][to];
 }
@@ -17,6 +17,31 @@ struct SegmentConfig {
   int intermediate; // -1 if none
 };
 
+// Digit glyphs as 7-bit masks: bit 0 = segment 1 ... bit 6 = segment 7
+#define SEGMENT_BIT(seg) (1u << ((seg) - 1))
+
+// Transition plans: at most 7 segment moves, plus 2 and 6 moving twice
+// around segment 7 during a collision sequence
+#define PLAN_MAX_MOVES 9
+
+// One segment move inside a transition plan
+struct PlanMove {
+  uint8_t segment;     // 1-7
+  uint8_t stagger;     // Start offset of independent moves, in stagger slots
+  uint8_t startAngle;
+  uint8_t targetAngle;
+  uint16_t deps;       // Bit i set: moves[i] must finish before this starts
+};
+
+// Move plan for one digit transition (from -> to). Moves form a dependency
+// graph derived from the collision rules; a move starts as soon as all of
+// its dependencies are done.
+struct TransitionPlan {
+  uint8_t moveCount;
+  bool collision; // Segment 7 toggles, 2 and 6 must clear it
+  PlanMove moves[PLAN_MAX_MOVES];
+};
+
 class MotionSegmentMap {
 public:
   // Get board and channel for a specific segment (1-7) of a digit
@@ -26,13 +51,28 @@ public:
   // Dedicated method for Separator
   static void getChannelSeparator(uint8_t &boardAddr, uint8_t &channel);
 
+  // Segment (1-7) a channel drives, 0 for the separator and spare channels
+  static int getSegment(uint8_t boardAddr, uint8_t channel);
+
   // Get angles for a segment (1-7)
   // Returns active, rest, and intermediate angles
   static SegmentConfig getAngles(int segment);
 
+  // The plans are proven collision-safe for the default angles: a segment
+  // covered by a collision rule must stay at rest outside the blocked
+  // range and be active inside it. False if an angle override breaks that.
+  static bool isAngleCollisionSafe(int segment, bool active, int angle);
+
+  // Segment mask for a number (0-9), 0 (all rest) if out of range
+  static uint8_t getDigitMask(int number);
+
   // Helper to get segments active for a number (0-9)
   // buffer must be size 7. Returns true/false for each segment 1-7.
   static void getSegmentsForDigit(int number, bool *buffer);
+
+  // Precompiled plan for a digit transition. Numbers out of range (e.g. -1
+  // for "unknown") are treated as all segments at rest.
+  static const TransitionPlan &getTransitionPlan(int fromNum, int toNum);
 };
 
 #endif // MOTION_SEGMENT_MAP_H
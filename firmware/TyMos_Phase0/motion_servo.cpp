@@ -1,15 +1,18 @@
 #include "motion_servo.h"
 #include "utils_logger.h"
+#include "utils_trace.h"
 
 MotionServo::MotionServo(HwPCA9685 *pwmDriver) {
   _pwm = pwmDriver;
   // Initialize trackers
-  for (int b = 0; b < 2; b++) {
-    for (int c = 0; c < 16; c++) {
-      _lastMoveTime[b][c] = 0;
-      _isActive[b][c] = false;
-    }
+  for (int i = 0; i < 32; i++) {
+    _holdMs[i] = SERVO_IDLE_TIMEOUT_MS;
+    _deadline[i] = 0;
+    _heapPos[i] = -1;
   }
+  _heapSize = 0;
+  _energized = 0;
+  loadCalibration();
 }
 
 int MotionServo::_getBoardIndex(uint8_t addr) {
@@ -39,83 +42,170 @@ uint16_t MotionServo::angleToPulse(int angle) {
   return (uint16_t)((us * 4096L) / 20000L);
 }
 
-void MotionServo::setAngle(uint8_t boardAddr, uint8_t channel, int angle) {
+uint16_t MotionServo::angleToPulse(uint8_t boardAddr, uint8_t channel,
+                                   int angle) {
   int bIdx = _getBoardIndex(boardAddr);
-  if (bIdx < 0)
-    return;
-
-  uint16_t pulse = angleToPulse(angle);
-  _pwm->setPWM(boardAddr, channel, 0, pulse);
+  if (bIdx < 0 || channel > 15)
+    return angleToPulse(angle);
 
-  _lastMoveTime[bIdx][channel] = millis();
-  _isActive[bIdx][channel] = true;
+  // Clamp angle
+  if (angle < 0)
+    angle = 0;
+  if (angle > 180)
+    angle = 180;
+  return _pulseTable[bIdx][channel][angle];
 }
 
-void MotionServo::moveToAngle(uint8_t boardAddr, uint8_t channel, int fromAngle,
-                              int toAngle, SpeedProfile speed) {
-  if (fromAngle == toAngle)
-    return;
+void MotionServo::loadCalibration() {
+  for (int b = 0; b < 2; b++) {
+    uint8_t addr = (b == 0) ? PCA9685_ADDR_HOURS : PCA9685_ADDR_MINUTES;
+    for (int c = 0; c < 16; c++) {
+      _buildPulseTable(b, c, Calibration.get(addr, c));
+    }
+  }
+}
 
-  // Select delay based on speed profile
-  int stepDelay;
-  switch (speed) {
-    case SPEED_FAST:
-      stepDelay = SPEED_FAST_DELAY_MS;
-      break;
-    case SPEED_NORMAL:
-      stepDelay = SPEED_NORMAL_DELAY_MS;
-      break;
-    case SPEED_NIGHT:
-    default:
-      stepDelay = SPEED_NIGHT_DELAY_MS;
-      break;
+void MotionServo::_buildPulseTable(int bIdx, uint8_t channel,
+                                   const ServoCalibration &cal) {
+  // Same conversion as angleToPulse(), with the channel's endpoints
+  for (int angle = 0; angle <= 180; angle++) {
+    long us = map(angle, 0, 180, cal.minPulseUs, cal.maxPulseUs);
+    _pulseTable[bIdx][channel][angle] = (uint16_t)((us * 4096L) / 20000L);
   }
+}
 
-  // Gradual movement with 5° steps for all profiles
-  int direction = (toAngle > fromAngle) ? 1 : -1;
-  int currentAngle = fromAngle;
+void MotionServo::setAngle(uint8_t boardAddr, uint8_t channel, int angle) {
+  int bIdx = _getBoardIndex(boardAddr);
+  if (bIdx < 0 || channel > 15)
+    return;
 
-  while (currentAngle != toAngle) {
-    // Calculate next step
-    int nextAngle = currentAngle + (direction * SPEED_STEP_DEGREES);
+  TRACE_EVENT(TRACE_SERVO_ANGLE, boardAddr, channel, angle);
+  setPulse(boardAddr, channel, angleToPulse(boardAddr, channel, angle));
+}
 
-    // Check if we've exceeded the target
-    if ((direction > 0 && nextAngle > toAngle) ||
-        (direction < 0 && nextAngle < toAngle)) {
-      nextAngle = toAngle;
-    }
+void MotionServo::setPulse(uint8_t boardAddr, uint8_t channel,
+                           uint16_t pulse) {
+  int bIdx = _getBoardIndex(boardAddr);
+  if (bIdx < 0 || channel > 15)
+    return;
 
-    setAngle(boardAddr, channel, nextAngle);
-    currentAngle = nextAngle;
+  TRACE_EVENT(TRACE_SERVO_PULSE, boardAddr, channel, pulse);
+  _pwm->setPulse(boardAddr, channel, pulse);
 
-    // Delay only if we haven't reached the target
-    if (currentAngle != toAngle) {
-      delay(stepDelay);
-    }
+  // Push the idle deadline back (the heap entry can only move down, unless
+  // the hold time was shortened)
+  uint8_t id = bIdx * 16 + channel;
+  _energized |= 1UL << id;
+  if (_holdMs[id] == SERVO_HOLD_FOREVER) {
+    _heapRemove(id);
+    return;
+  }
+  _deadline[id] = millis() + _holdMs[id];
+  if (_heapPos[id] < 0) {
+    _heapPos[id] = _heapSize;
+    _heap[_heapSize++] = id;
+    _heapUp(_heapPos[id]);
+  } else {
+    _heapUp(_heapPos[id]);
+    _heapDown(_heapPos[id]);
   }
 }
 
 void MotionServo::detach(uint8_t boardAddr, uint8_t channel) {
   int bIdx = _getBoardIndex(boardAddr);
-  if (bIdx < 0)
+  if (bIdx < 0 || channel > 15)
     return;
 
+  TRACE_EVENT(TRACE_SERVO_DETACH, boardAddr, channel, 0);
   _pwm->setPWM(boardAddr, channel, 0, 0); // Full off
-  _isActive[bIdx][channel] = false;
+  _energized &= ~(1UL << (bIdx * 16 + channel));
+  _heapRemove(bIdx * 16 + channel);
 }
 
+uint8_t MotionServo::energizedCount() { return __builtin_popcount(_energized); }
+
+void MotionServo::setHoldTime(uint8_t boardAddr, uint8_t channel,
+                              uint32_t holdMs) {
+  int bIdx = _getBoardIndex(boardAddr);
+  if (bIdx < 0 || channel > 15)
+    return;
+  _holdMs[bIdx * 16 + channel] = holdMs;
+}
+
+void MotionServo::beginFrame() { _pwm->beginFrame(); }
+
+void MotionServo::endFrame() { _pwm->endFrame(); }
+
 void MotionServo::checkIdle() {
+  // Frames that did not make it onto the bus (queue full, bus failure)
+  if (_pwm->hasPending())
+    _pwm->flush();
+
+  if (!_heapSize)
+    return;
   uint32_t now = millis();
-  for (int b = 0; b < 2; b++) {
-    uint8_t addr = (b == 0) ? PCA9685_ADDR_HOURS : PCA9685_ADDR_MINUTES;
-    for (int c = 0; c < 16; c++) {
-      if (_isActive[b][c]) {
-        if (now - _lastMoveTime[b][c] > SERVO_IDLE_TIMEOUT_MS) {
-          detach(addr, c);
-          // Logger.debug("Auto-idle: Board 0x%X Ch %d", addr, c);
-          // Commented out to reduce log spam unless needed
-        }
-      }
-    }
+  if ((int32_t)(now - _deadline[_heap[0]]) <= 0)
+    return;
+
+  // Everything expired goes out together: one burst per board
+  beginFrame();
+  while (_heapSize && (int32_t)(now - _deadline[_heap[0]]) > 0) {
+    uint8_t id = _heap[0];
+    detach(id < 16 ? PCA9685_ADDR_HOURS : PCA9685_ADDR_MINUTES, id % 16);
   }
+  endFrame();
+}
+
+// Wrap-safe deadline order of two heap slots
+bool MotionServo::_heapBefore(int a, int b) {
+  return (int32_t)(_deadline[_heap[a]] - _deadline[_heap[b]]) < 0;
+}
+
+void MotionServo::_heapSwap(int a, int b) {
+  uint8_t t = _heap[a];
+  _heap[a] = _heap[b];
+  _heap[b] = t;
+  _heapPos[_heap[a]] = a;
+  _heapPos[_heap[b]] = b;
+}
+
+void MotionServo::_heapUp(int pos) {
+  while (pos > 0) {
+    int parent = (pos - 1) / 2;
+    if (!_heapBefore(pos, parent))
+      break;
+    _heapSwap(pos, parent);
+    pos = parent;
+  }
+}
+
+void MotionServo::_heapDown(int pos) {
+  for (;;) {
+    int least = pos;
+    int left = 2 * pos + 1;
+    int right = left + 1;
+    if (left < _heapSize && _heapBefore(left, least))
+      least = left;
+    if (right < _heapSize && _heapBefore(right, least))
+      least = right;
+    if (least == pos)
+      break;
+    _heapSwap(pos, least);
+    pos = least;
+  }
+}
+
+void MotionServo::_heapRemove(uint8_t id) {
+  int pos = _heapPos[id];
+  if (pos < 0)
+    return;
+  _heapPos[id] = -1;
+  if (--_heapSize == pos)
+    return;
+  // Move the last entry into the hole and restore the order
+  uint8_t moved = _heap[_heapSize];
+  _heap[pos] = moved;
+  _heapPos[moved] = pos;
+  _heapUp(pos);
+  _heapDown(_heapPos[moved]);
 }
@@ -3,37 +3,77 @@
 
 #include "config.h"
 #include "hw_pca9685.h"
+#include "motion_calibration.h"
 #include <Arduino.h>
 
 class MotionServo {
 public:
   MotionServo(HwPCA9685 *pwmDriver);
 
-  // Convert angle (0-180) to PWM pulse
+  // Convert angle (0-180) to PWM pulse with the default endpoints
   uint16_t angleToPulse(int angle);
 
+  // Convert angle (0-180) to PWM pulse for a calibrated channel (lookup)
+  uint16_t angleToPulse(uint8_t boardAddr, uint8_t channel, int angle);
+
+  // Rebuild the per-channel pulse tables from Calibration
+  void loadCalibration();
+
   // Set servo angle immediately (updates idle timer)
   void setAngle(uint8_t boardAddr, uint8_t channel, int angle);
 
-  // Move servo to target angle with speed profile
-  // FAST: 5° steps with 10ms delay
-  // NORMAL: 5° steps with 50ms delay
-  // NIGHT: 5° steps with 100ms delay
-  void moveToAngle(uint8_t boardAddr, uint8_t channel, int fromAngle,
-                   int toAngle, SpeedProfile speed);
+  // Write a raw 12-bit pulse width (updates idle timer), at the channel's
+  // phase offset. Used by the scheduler to interpolate between calibrated
+  // endpoints.
+  void setPulse(uint8_t boardAddr, uint8_t channel, uint16_t pulse);
 
   // Detach servo (PWM 0)
   void detach(uint8_t boardAddr, uint8_t channel);
 
-  // Check for idle servos and detach them if timeout expired
+  // Hold policy: how long a channel keeps its pulse after the last write
+  // before checkIdle() detaches it (SERVO_IDLE_TIMEOUT_MS by default,
+  // SERVO_HOLD_FOREVER never detaches). Applies from the next write.
+  void setHoldTime(uint8_t boardAddr, uint8_t channel, uint32_t holdMs);
+
+  // Detach every channel whose hold time has run out, in one frame. Only
+  // looks at the earliest deadline unless something expired. Also flushes
+  // PWM writes still pending after a full queue or a failed burst.
   void checkIdle();
 
+  // Channels currently receiving a pulse (moving or holding). Motion task
+  // only: other tasks go through MotionScheduler::estimateScheduleMs()
+  uint8_t energizedCount();
+
+  // Group PWM writes of one tick into a single flush per board
+  void beginFrame();
+  void endFrame();
+
 private:
   HwPCA9685 *_pwm;
-  uint32_t _lastMoveTime[2][16]; // [boardIndex][channel] 0=0x40, 1=0x41
-  bool _isActive[2][16];
+
+  // Idle deadlines, indexed by boardIndex * 16 + channel (0=0x40, 1=0x41).
+  // Channels holding a pulse with a finite hold time sit in a binary
+  // min-heap on their deadline; _heapPos is -1 for the others.
+  uint32_t _holdMs[32];
+  uint32_t _deadline[32];
+  uint8_t _heap[32];
+  int8_t _heapPos[32];
+  uint8_t _heapSize;
+  uint32_t _energized; // Bit per id: pulse on
+
+  // Angle -> 12-bit count, per channel, expanded from Calibration
+  uint16_t _pulseTable[2][16][181];
+
+  void _buildPulseTable(int bIdx, uint8_t channel,
+                        const ServoCalibration &cal);
 
   int _getBoardIndex(uint8_t addr);
+
+  bool _heapBefore(int a, int b);
+  void _heapSwap(int a, int b);
+  void _heapUp(int pos);
+  void _heapDown(int pos);
+  void _heapRemove(uint8_t id);
 };
 
 #endif // MOTION_SERVO_H
@@ -0,0 +1,120 @@
+#include "motion_task.h"
+#include "hw_i2c_bus.h"
+#include "motion_pose_store.h"
+#include "utils_logger.h"
+#include "utils_profiler.h"
+
+MotionTask::MotionTask(MotionEngine *engine) {
+  _engine = engine;
+  _busy = false;
+  _posted = 0;
+  _handled = 0;
+  _started = false;
+  _pose = DisplayState();
+  _poseMoving = false;
+  _lastStepTicks = 0;
+  _stepped = false;
+#if MOTION_USE_TASK
+  _task = NULL;
+#endif
+}
+
+void MotionTask::begin(const DisplayState &pose) {
+  if (_started)
+    return;
+  _started = true;
+  _pose = pose;
+
+#if MOTION_USE_TASK
+  xTaskCreatePinnedToCore(_taskMain, "motion", MOTION_TASK_STACK, this,
+                          MOTION_TASK_PRIORITY, &_task, MOTION_TASK_CORE);
+  Logger.info("Motion task started on core %d", MOTION_TASK_CORE);
+#endif
+}
+
+#if MOTION_USE_TASK
+void MotionTask::_taskMain(void *arg) {
+  MotionTask *self = (MotionTask *)arg;
+  for (;;) {
+    self->step();
+    vTaskDelay(pdMS_TO_TICKS(MOTION_TASK_PERIOD_MS));
+  }
+}
+#endif
+
+bool MotionTask::postDisplay(const DisplayState &from, const DisplayState &to) {
+  MotionCommand cmd;
+  cmd.type = MOTION_CMD_DISPLAY;
+  cmd.active = false;
+  cmd.from = from;
+  cmd.to = to;
+  if (!_commands.push(cmd)) {
+    Logger.warning("Motion command queue full");
+    return false;
+  }
+  _posted++;
+  return true;
+}
+
+bool MotionTask::postSeparator(bool active) {
+  MotionCommand cmd;
+  cmd.type = MOTION_CMD_SEPARATOR;
+  cmd.active = active;
+  cmd.from = DisplayState();
+  cmd.to = DisplayState();
+  if (!_commands.push(cmd)) {
+    Logger.warning("Motion command queue full");
+    return false;
+  }
+  _posted++;
+  return true;
+}
+
+uint32_t MotionTask::estimateDisplayMs(const DisplayState &from,
+                                       const DisplayState &to) {
+  return _engine->estimateDisplayMs(from, to);
+}
+
+void MotionTask::step() {
+  uint32_t start = Profiler.now();
+  if (_stepped)
+    Profiler.record(PROF_MOTION_PERIOD, start - _lastStepTicks);
+  _lastStepTicks = start;
+  _stepped = true;
+
+  MotionCommand cmd;
+  while (_commands.pop(cmd)) {
+    switch (cmd.type) {
+      case MOTION_CMD_DISPLAY:
+        _engine->updateDisplay(cmd.from, cmd.to);
+        _pose = cmd.to;
+        break;
+      case MOTION_CMD_SEPARATOR:
+        _engine->setSeparator(cmd.active);
+        _pose.separator = cmd.active;
+        break;
+    }
+    // Recorded before the first frame goes out
+    if (!_poseMoving) {
+      PoseStore.markMoving(_pose);
+      _poseMoving = true;
+    }
+    _busy = true;
+    _handled++;
+  }
+
+  uint32_t t = Profiler.now();
+  _engine->tick();
+  t = Profiler.lap(PROF_MOTION_TICK, t);
+  I2CBus.update();
+  Profiler.lap(PROF_MOTION_I2C, t);
+  bool busy = _engine->isBusy();
+  if (_poseMoving && !busy) {
+    PoseStore.markSettled(_pose);
+    _poseMoving = false;
+  }
+  _busy = busy;
+  Profiler.record(PROF_MOTION_STEP, Profiler.now() - start);
+}
+
+bool MotionTask::isBusy() { return _posted != _handled || _busy; }
@@ -0,0 +1,80 @@
+#ifndef MOTION_TASK_H
+#define MOTION_TASK_H
+
+#include "config.h"
+#include "motion_engine.h"
+#include "utils_spsc_ring.h"
+#include <Arduino.h>
+#include <atomic>
+
+#if MOTION_USE_TASK
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+enum MotionCommandType {
+  MOTION_CMD_DISPLAY,  // updateDisplay(from, to)
+  MOTION_CMD_SEPARATOR // setSeparator(active)
+};
+
+// Request from the control side (display manager) to the motion side
+struct MotionCommand {
+  uint8_t type; // MotionCommandType
+  bool active;
+  DisplayState from;
+  DisplayState to;
+};
+
+// Runs the motion stack on its own core. The control side (WiFi, OTA,
+// display decisions on core 0) only posts commands through a lock-free
+// ring, so network stalls never delay servo frames and long transitions
+// never delay OTA.
+class MotionTask {
+public:
+  MotionTask(MotionEngine *engine);
+
+  // Start the task pinned to MOTION_TASK_CORE, from the pose the servos
+  // are in (restored or homed). Host builds have no task and call step()
+  // from their own loop.
+  void begin(const DisplayState &pose);
+
+  // Control side: queue a display change. False if the ring is full.
+  bool postDisplay(const DisplayState &from, const DisplayState &to);
+  bool postSeparator(bool active);
+
+  // Control side: expected settle time of a display change. Reads the
+  // plan tables, calibration, and the energized count and current budget
+  // the scheduler publishes atomically, so it is safe from either core.
+  uint32_t estimateDisplayMs(const DisplayState &from, const DisplayState &to);
+
+  // Motion side: run queued commands, advance trajectories, run I2C
+  // completions (the PCA9685 callbacks must stay on this task) and keep
+  // PoseStore up to date for the next boot
+  void step();
+
+  // True while commands are queued or servos are moving
+  bool isBusy();
+
+private:
+  MotionEngine *_engine;
+  SpscRing<MotionCommand, MOTION_COMMAND_QUEUE> _commands;
+  std::atomic<bool> _busy;
+  std::atomic<uint16_t> _posted;  // Written by the control side
+  std::atomic<uint16_t> _handled; // Written by the motion side
+  bool _started;
+
+  // Last commanded pose (motion side), recorded in PoseStore
+  DisplayState _pose;
+  bool _poseMoving;
+
+  // Profiler timestamp of the previous step() (loop period)
+  uint32_t _lastStepTicks;
+  bool _stepped;
+
+#if MOTION_USE_TASK
+  TaskHandle_t _task;
+  static void _taskMain(void *arg);
+#endif
+};
+
+#endif // MOTION_TASK_H
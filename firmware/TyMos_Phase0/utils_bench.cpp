@@ -0,0 +1,149 @@
+#include "utils_bench.h"
+
+#if BENCH_ENABLED
+
+#include "motion_collision.h"
+#include "motion_engine.h"
+#include "motion_scheduler.h"
+#include "motion_segment_map.h"
+#include "motion_servo.h"
+#include "utils_logger.h"
+
+// Private motion stack: begin() is never called on the driver, and the
+// kernels only plan moves (nothing is ticked), so no PWM write happens
+static HwPCA9685 benchPwm;
+static MotionServo benchServo(&benchPwm);
+static MotionScheduler benchScheduler(&benchServo);
+static MotionCollision benchCollision(&benchScheduler);
+static MotionEngine benchEngine(&benchServo, &benchCollision,
+                                &benchScheduler);
+
+static uint8_t boardFor(uint32_t i) {
+  return (i & 16) ? PCA9685_ADDR_MINUTES : PCA9685_ADDR_HOURS;
+}
+
+static uint32_t benchAngleToPulse(uint32_t iterations) {
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < iterations; i++)
+    sum += benchServo.angleToPulse(boardFor(i), i & 15, i % 181);
+  return sum;
+}
+
+static uint32_t benchAngleToPulseDefault(uint32_t iterations) {
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < iterations; i++)
+    sum += benchServo.angleToPulse((int)(i % 181));
+  return sum;
+}
+
+static uint32_t benchGetChannel(uint32_t iterations) {
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    uint8_t b, c;
+    MotionSegmentMap::getChannel((DigitPosition)(i & 3), 1 + i % 7, b, c);
+    sum += b + c;
+  }
+  return sum;
+}
+
+static uint32_t benchGetAngles(uint32_t iterations) {
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    SegmentConfig cfg = MotionSegmentMap::getAngles(1 + i % 7);
+    sum += cfg.active + cfg.rest + cfg.intermediate;
+  }
+  return sum;
+}
+
+static uint32_t benchSegmentsForDigit(uint32_t iterations) {
+  uint32_t sum = 0;
+  bool segments[7];
+  for (uint32_t i = 0; i < iterations; i++) {
+    MotionSegmentMap::getSegmentsForDigit(i % 10, segments);
+    sum += segments[i % 7];
+  }
+  return sum;
+}
+
+static uint32_t benchNeedsCollision(uint32_t iterations) {
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < iterations; i++)
+    sum += benchCollision.needsCollisionLogic(i % 10, (i / 10) % 10);
+  return sum;
+}
+
+// Plan generation for every digit transition in turn (collision sequences
+// included), then drop the queued moves
+static uint32_t benchUpdateDigit(uint32_t iterations) {
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    int from = i % 10;
+    int to = (i / 10) % 10;
+    benchEngine.updateDigit((DigitPosition)(i & 3), from, to);
+    sum += benchScheduler.isIdle();
+    benchScheduler.clear();
+  }
+  return sum;
+}
+
+static uint32_t benchLoggerFormat(uint32_t iterations) {
+  uint32_t sum = 0;
+  char line[128];
+  for (uint32_t i = 0; i < iterations; i++) {
+    sum += Logger.formatMessage(line, sizeof(line),
+                                "I2C bus: %lu%% busy, %-5s latency %lu us "
+                                "temp %.2f C",
+                                (unsigned long)(i % 100), "servo",
+                                (unsigned long)i, 21.5);
+  }
+  return sum;
+}
+
+const BenchKernel BENCH_KERNELS[] = {
+    {"angle_to_pulse", benchAngleToPulse},
+    {"angle_to_pulse_default", benchAngleToPulseDefault},
+    {"segment_get_channel", benchGetChannel},
+    {"segment_get_angles", benchGetAngles},
+    {"segment_for_digit", benchSegmentsForDigit},
+    {"collision_check", benchNeedsCollision},
+    {"engine_update_digit", benchUpdateDigit},
+    {"logger_format", benchLoggerFormat},
+};
+const uint8_t BENCH_KERNEL_COUNT =
+    sizeof(BENCH_KERNELS) / sizeof(BENCH_KERNELS[0]);
+
+static uint32_t cycleCount() {
+#ifdef ARDUINO_ARCH_ESP32
+  return ESP.getCycleCount();
+#else
+  return (uint32_t)micros();
+#endif
+}
+
+void benchRunAll() {
+  Logger.flush();
+  Serial.println("# tymos-bench cycles/op");
+  char line[64];
+  volatile uint32_t sink = 0;
+  for (uint8_t k = 0; k < BENCH_KERNEL_COUNT; k++) {
+    const BenchKernel &kernel = BENCH_KERNELS[k];
+    kernel.run(BENCH_TARGET_ITERATIONS / 10); // Warm the caches
+
+    // Best of a few runs: preemption by the other tasks only adds time
+    uint32_t best = UINT32_MAX;
+    for (int r = 0; r < 5; r++) {
+      uint32_t start = cycleCount();
+      sink += kernel.run(BENCH_TARGET_ITERATIONS);
+      uint32_t cycles = cycleCount() - start;
+      if (cycles < best)
+        best = cycles;
+    }
+    snprintf(line, sizeof(line), "%-24s %8.1f", kernel.name,
+             (double)best / BENCH_TARGET_ITERATIONS);
+    Serial.println(line);
+  }
+  (void)sink;
+  Serial.println("# end");
+}
+
+#endif // BENCH_ENABLED
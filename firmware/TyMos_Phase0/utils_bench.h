@@ -0,0 +1,33 @@
+#ifndef UTILS_BENCH_H
+#define UTILS_BENCH_H
+
+#include "config.h"
+#include <Arduino.h>
+
+// ============================================================================
+// BENCH - Microbenchmark kernels for the motion hot paths
+// ============================================================================
+// The same kernels run on the host (host-sim/bench/tymos_bench.cpp, wall
+// clock in ns/op) and on the ESP32 ('b' on the serial console, CPU cycles
+// per op). Kernels use their own servo/scheduler/engine instances over a
+// PWM driver that was never started, so they never touch the live motion
+// stack or the bus. BENCH_ENABLED 0 (the default on the clock) compiles
+// them out.
+
+struct BenchKernel {
+  const char *name;
+  // Run `iterations` operations and return a checksum of the results (so
+  // the work cannot be optimized away)
+  uint32_t (*run)(uint32_t iterations);
+};
+
+#if BENCH_ENABLED
+extern const BenchKernel BENCH_KERNELS[];
+extern const uint8_t BENCH_KERNEL_COUNT;
+
+// On-target mode: run every kernel BENCH_TARGET_ITERATIONS times and print
+// the cycles per operation over Serial
+void benchRunAll();
+#endif
+
+#endif // UTILS_BENCH_H
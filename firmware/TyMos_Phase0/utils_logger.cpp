@@ -1,36 +1,141 @@
 #include "utils_logger.h"
+#include <stddef.h>
 
 LoggerClass Logger;
 
+static const char *LEVEL_NAMES[] = {"ERROR", "WARN", "INFO"};
+
+// Length modifier of a conversion, decides the va_arg type
+enum LogArgLength : uint8_t {
+  LEN_INT,
+  LEN_LONG,
+  LEN_LLONG,  // ll, j
+  LEN_SIZE,   // z
+  LEN_PTRDIFF // t (32-bit on the ESP32)
+};
+
+// One conversion of a format string: format[start, end) is the spec text
+struct LogSpec {
+  const char *start;
+  const char *end;
+  char conv; // 0 at the end of the format
+  uint8_t length;
+  bool starWidth;
+  bool starPrecision;
+};
+
+// Find the next conversion from p (literal text in between is skipped,
+// "%%" is returned as conv '%'). Shared by the producer, which copies the
+// arguments, and the consumer, which formats them.
+static const char *nextSpec(const char *p, LogSpec &spec) {
+  while (*p && *p != '%')
+    p++;
+  spec.start = p;
+  spec.conv = 0;
+  if (!*p)
+    return p;
+  p++;
+  while (*p && strchr("-+ #0", *p))
+    p++;
+  spec.starWidth = *p == '*';
+  if (spec.starWidth)
+    p++;
+  while (*p >= '0' && *p <= '9')
+    p++;
+  spec.starPrecision = false;
+  if (*p == '.') {
+    p++;
+    spec.starPrecision = *p == '*';
+    if (spec.starPrecision)
+      p++;
+    while (*p >= '0' && *p <= '9')
+      p++;
+  }
+  spec.length = LEN_INT;
+  while (*p && strchr("hlzjtL", *p)) {
+    if (*p == 'l')
+      spec.length = spec.length == LEN_LONG ? LEN_LLONG : LEN_LONG;
+    else if (*p == 'z')
+      spec.length = LEN_SIZE;
+    else if (*p == 't')
+      spec.length = LEN_PTRDIFF;
+    else if (*p == 'j')
+      spec.length = LEN_LLONG;
+    p++;
+  }
+  spec.conv = *p;
+  if (*p)
+    p++;
+  spec.end = p;
+  return p;
+}
+
+static bool isSigned(char conv) { return conv == 'd' || conv == 'i'; }
+
+static bool isUnsigned(char conv) {
+  return conv == 'u' || conv == 'x' || conv == 'X' || conv == 'o' ||
+         conv == 'c';
+}
+
+static bool isFloat(char conv) { return conv && strchr("fFeEgGaA", conv); }
+
+LoggerClass::LoggerClass() {
+  _dropped = 0;
+  _droppedReported = 0;
+#if LOG_USE_TASK
+  _task = NULL;
+#endif
+}
+
 void LoggerClass::begin() {
   Serial.begin(115200);
   // Wait for serial port? No, usually not blocking
   Serial.println("\n\n--- TyMos v2.0 Logger Initialized ---");
+
+#if LOG_USE_TASK
+  if (!_task)
+    xTaskCreate(_taskMain, "logger", LOG_TASK_STACK, this, LOG_TASK_PRIORITY,
+                &_task);
+#endif
+}
+
+#if LOG_USE_TASK
+void LoggerClass::_taskMain(void *arg) {
+  LoggerClass *logger = (LoggerClass *)arg;
+  for (;;) {
+    logger->_drain();
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+  }
 }
+#endif
 
+#if LOG_LEVEL >= LOG_LEVEL_INFO
 void LoggerClass::info(const char *format, ...) {
   va_list args;
   va_start(args, format);
-  log("INFO", format, args);
+  log(LOG_LEVEL_INFO, format, args);
   va_end(args);
 }
+#endif
 
+#if LOG_LEVEL >= LOG_LEVEL_WARNING
 void LoggerClass::warning(const char *format, ...) {
   va_list args;
   va_start(args, format);
-  log("WARN", format, args);
+  log(LOG_LEVEL_WARNING, format, args);
   va_end(args);
 }
+#endif
 
 void LoggerClass::error(const char *format, ...) {
   va_list args;
   va_start(args, format);
-  log("ERROR", format, args);
+  log(LOG_LEVEL_ERROR, format, args);
   va_end(args);
 }
 
-void LoggerClass::getTimestamp(char *buffer, size_t bufferSize) {
-  unsigned long m = millis();
+void LoggerClass::getTimestamp(uint32_t ms, char *buffer, size_t bufferSize) {
+  unsigned long m = ms;
   unsigned long seconds = m / 1000;
   unsigned long minutes = seconds / 60;
   unsigned long hours = minutes / 60;
@@ -39,16 +144,262 @@ void LoggerClass::getTimestamp(char *buffer, size_t bufferSize) {
            (minutes % 60), (seconds % 60), (m % 1000));
 }
 
-void LoggerClass::log(const char *level, const char *format, va_list args) {
+void LoggerClass::log(uint8_t level, const char *format, va_list args) {
+  LogRecord rec;
+  _capture(rec, level, format, args);
+
+  if (!_ring.push(rec))
+    _dropped++;
+
+#if !LOG_USE_TASK
+  _drain();
+#endif
+}
+
+size_t LoggerClass::formatMessage(char *buffer, size_t size,
+                                  const char *format, ...) {
+  LogRecord rec;
+  va_list args;
+  va_start(args, format);
+  _capture(rec, LOG_LEVEL_INFO, format, args);
+  va_end(args);
+  return _format(rec, buffer, size);
+}
+
+void LoggerClass::_capture(LogRecord &rec, uint8_t level, const char *format,
+                           va_list args) {
+  rec.timestampMs = millis();
+  rec.level = level;
+  rec.argCount = 0;
+  rec.stringBytes = 0;
+  rec.format = format;
+
+  // Copy the raw arguments in the order the format consumes them;
+  // formatting waits for the logger task
+  LogSpec spec;
+  const char *p = format;
+  for (;;) {
+    p = nextSpec(p, spec);
+    if (!spec.conv)
+      break;
+    if (spec.conv == '%')
+      continue;
+    int needed = 1 + spec.starWidth + spec.starPrecision;
+    if (rec.argCount + needed > LOG_MAX_ARGS)
+      break; // The rest prints as the bare spec
+    if (spec.starWidth)
+      rec.args[rec.argCount++].i = va_arg(args, int);
+    if (spec.starPrecision)
+      rec.args[rec.argCount++].i = va_arg(args, int);
+
+    LogArg &arg = rec.args[rec.argCount++];
+    if (isSigned(spec.conv)) {
+      switch (spec.length) {
+      case LEN_LONG:
+        arg.i = va_arg(args, long);
+        break;
+      case LEN_LLONG:
+        arg.i = va_arg(args, long long);
+        break;
+      case LEN_SIZE:
+        arg.i = (long long)va_arg(args, size_t);
+        break;
+      case LEN_PTRDIFF:
+        arg.i = va_arg(args, ptrdiff_t);
+        break;
+      default:
+        arg.i = va_arg(args, int);
+        break;
+      }
+    } else if (isUnsigned(spec.conv)) {
+      switch (spec.length) {
+      case LEN_LONG:
+        arg.u = va_arg(args, unsigned long);
+        break;
+      case LEN_LLONG:
+        arg.u = va_arg(args, unsigned long long);
+        break;
+      case LEN_SIZE:
+        arg.u = va_arg(args, size_t);
+        break;
+      case LEN_PTRDIFF:
+        arg.u = (size_t)va_arg(args, ptrdiff_t);
+        break;
+      default:
+        arg.u = va_arg(args, unsigned int);
+        break;
+      }
+    } else if (isFloat(spec.conv)) {
+      arg.f = va_arg(args, double);
+    } else if (spec.conv == 's') {
+      // Strings are often temporaries (String::c_str()): keep a copy,
+      // stored as an offset into rec.strings
+      const char *s = va_arg(args, const char *);
+      if (!s)
+        s = "(null)";
+      size_t room = LOG_STRING_BYTES - rec.stringBytes;
+      size_t n = strnlen(s, room ? room - 1 : 0);
+      arg.u = rec.stringBytes;
+      if (room) {
+        memcpy(rec.strings + rec.stringBytes, s, n);
+        rec.strings[rec.stringBytes + n] = '\0';
+        rec.stringBytes += n + 1;
+      } else {
+        arg.u = LOG_STRING_BYTES; // Out of room: prints empty
+      }
+    } else if (spec.conv == 'p') {
+      arg.p = va_arg(args, void *);
+    } else {
+      rec.argCount--; // Unsupported conversion: stop copying here
+      break;
+    }
+  }
+}
+
+size_t LoggerClass::_format(const LogRecord &rec, char *msg, size_t size) {
+  if (!size)
+    return 0;
+  size_t len = 0;
+  uint8_t next = 0;
+
+  LogSpec spec;
+  const char *p = rec.format;
+  const char *literal = p;
+  for (;;) {
+    p = nextSpec(p, spec);
+    // Literal text up to the spec
+    size_t n = spec.start - literal;
+    if (n > size - 1 - len)
+      n = size - 1 - len;
+    memcpy(msg + len, literal, n);
+    len += n;
+    literal = p;
+    if (!spec.conv)
+      break;
+
+    size_t room = size - len;
+    int needed = 1 + spec.starWidth + spec.starPrecision;
+    if (spec.conv == '%') {
+      if (room > 1)
+        msg[len++] = '%';
+      continue;
+    }
+    if (next + needed > rec.argCount) {
+      // Not captured: print the spec itself
+      n = spec.end - spec.start;
+      if (n > room - 1)
+        n = room - 1;
+      memcpy(msg + len, spec.start, n);
+      len += n;
+      continue;
+    }
+
+    // Spec text with '*' replaced by the captured width/precision
+    char fmt[24];
+    size_t f = 0;
+    for (const char *s = spec.start; s < spec.end && f < sizeof(fmt) - 12;
+         s++) {
+      if (*s == '*')
+        f += snprintf(fmt + f, sizeof(fmt) - f, "%d",
+                      (int)rec.args[next++].i);
+      else
+        fmt[f++] = *s;
+    }
+    fmt[f] = '\0';
+
+    const LogArg &arg = rec.args[next++];
+    int w = 0;
+    if (isSigned(spec.conv)) {
+      switch (spec.length) {
+      case LEN_LONG:
+        w = snprintf(msg + len, room, fmt, (long)arg.i);
+        break;
+      case LEN_LLONG:
+        w = snprintf(msg + len, room, fmt, arg.i);
+        break;
+      case LEN_SIZE:
+        w = snprintf(msg + len, room, fmt, (size_t)arg.i);
+        break;
+      case LEN_PTRDIFF:
+        w = snprintf(msg + len, room, fmt, (ptrdiff_t)arg.i);
+        break;
+      default:
+        w = snprintf(msg + len, room, fmt, (int)arg.i);
+        break;
+      }
+    } else if (isUnsigned(spec.conv)) {
+      switch (spec.length) {
+      case LEN_LONG:
+        w = snprintf(msg + len, room, fmt, (unsigned long)arg.u);
+        break;
+      case LEN_LLONG:
+        w = snprintf(msg + len, room, fmt, arg.u);
+        break;
+      case LEN_SIZE:
+        w = snprintf(msg + len, room, fmt, (size_t)arg.u);
+        break;
+      case LEN_PTRDIFF:
+        w = snprintf(msg + len, room, fmt, (ptrdiff_t)arg.u);
+        break;
+      default:
+        w = snprintf(msg + len, room, fmt, (unsigned int)arg.u);
+        break;
+      }
+    } else if (isFloat(spec.conv)) {
+      w = snprintf(msg + len, room, fmt, arg.f);
+    } else if (spec.conv == 's') {
+      const char *s = arg.u < LOG_STRING_BYTES ? rec.strings + arg.u : "";
+      w = snprintf(msg + len, room, fmt, s);
+    } else {
+      w = snprintf(msg + len, room, fmt, arg.p);
+    }
+    if (w > 0)
+      len += (size_t)w < room ? (size_t)w : room - 1;
+  }
+  msg[len] = '\0';
+  return len;
+}
+
+void LoggerClass::_print(const LogRecord &rec) {
+  char msg[128];
+  _format(rec, msg, sizeof(msg));
+
   char timestamp[20];
-  getTimestamp(timestamp, sizeof(timestamp));
+  getTimestamp(rec.timestampMs, timestamp, sizeof(timestamp));
 
   Serial.print(timestamp);
   Serial.print("[");
-  Serial.print(level);
+  Serial.print(LEVEL_NAMES[rec.level]);
   Serial.print("] ");
-
-  char msg[128];
-  vsnprintf(msg, sizeof(msg), format, args);
   Serial.println(msg);
 }
+
+void LoggerClass::_drain() {
+  LogRecord rec;
+  while (_ring.pop(rec)) {
+    _print(rec);
+  }
+
+  uint32_t dropped = _dropped;
+  if (dropped != _droppedReported) {
+    char line[64];
+    snprintf(line, sizeof(line), "[WARN] %lu log messages dropped",
+             (unsigned long)(dropped - _droppedReported));
+    Serial.println(line);
+    _droppedReported = dropped;
+  }
+}
+
+void LoggerClass::flush(uint32_t timeoutMs) {
+#if LOG_USE_TASK
+  uint32_t start = millis();
+  while (!_ring.isEmpty() && millis() - start < timeoutMs) {
+    delay(1);
+  }
+#else
+  (void)timeoutMs;
+  _drain();
+#endif
+}
+
+uint32_t LoggerClass::getDropped() { return _dropped; }
@@ -1,22 +1,96 @@
 #ifndef UTILS_LOGGER_HPP
 #define UTILS_LOGGER_HPP
 
+#include "config.h"
+#include "utils_mpsc_ring.h"
 #include <Arduino.h>
+#include <atomic>
+
+#if LOG_USE_TASK
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
 
 // ============================================================================
 // LOGGER - Sistema logging multilivello
 // ============================================================================
+// info/warning/error only store a compact record (timestamp, level, format
+// pointer, raw arguments) in a lock-free ring; a low-priority task formats
+// and prints it. A full ring drops the record and counts it instead of
+// blocking the caller. Levels above LOG_LEVEL compile to nothing.
+// Format strings must be literals (or otherwise outlive the record); %s
+// arguments are copied.
+
+// Raw argument of a record, by conversion type
+union LogArg {
+  long long i;
+  unsigned long long u;
+  double f;
+  const void *p;
+};
+
+struct LogRecord {
+  uint32_t timestampMs;
+  uint8_t level;
+  uint8_t argCount;
+  uint8_t stringBytes;
+  const char *format;
+  LogArg args[LOG_MAX_ARGS];
+  char strings[LOG_STRING_BYTES]; // %s arguments, NUL separated
+};
+
+#define LOG_FORMAT_CHECK __attribute__((format(printf, 2, 3)))
 
 class LoggerClass {
 public:
+  LoggerClass();
   void begin();
-  void info(const char* format, ...);
-  void warning(const char* format, ...);
-  void error(const char* format, ...);
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+  void info(const char *format, ...) LOG_FORMAT_CHECK;
+#else
+  void info(const char *, ...) {}
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARNING
+  void warning(const char *format, ...) LOG_FORMAT_CHECK;
+#else
+  void warning(const char *, ...) {}
+#endif
+  void error(const char *format, ...) LOG_FORMAT_CHECK;
+
+  // Wait (up to timeoutMs) until every queued record has been printed,
+  // e.g. before a reboot
+  void flush(uint32_t timeoutMs = 500);
+
+  // Records lost because the ring was full
+  uint32_t getDropped();
+
+  // Capture and format a message the way info() would, into buffer
+  // instead of the ring (benchmarks, no Serial output). Returns its length.
+  size_t formatMessage(char *buffer, size_t size, const char *format, ...)
+      __attribute__((format(printf, 4, 5)));
 
 private:
-  void log(const char* level, const char* format, va_list args);
-  void getTimestamp(char* buffer, size_t bufferSize);
+  MpscRing<LogRecord, LOG_RING_SIZE> _ring;
+  std::atomic<uint32_t> _dropped;
+  uint32_t _droppedReported;
+
+  void log(uint8_t level, const char *format, va_list args);
+  void getTimestamp(uint32_t ms, char *buffer, size_t bufferSize);
+
+  // Producer side: copy the arguments the format consumes
+  void _capture(LogRecord &rec, uint8_t level, const char *format,
+                va_list args);
+
+  // Consumer side: format and print everything queued
+  void _drain();
+  size_t _format(const LogRecord &rec, char *msg, size_t size);
+  void _print(const LogRecord &rec);
+
+#if LOG_USE_TASK
+  TaskHandle_t _task;
+  static void _taskMain(void *arg);
+#endif
 };
 
 extern LoggerClass Logger;
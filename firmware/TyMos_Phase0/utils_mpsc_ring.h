@@ -0,0 +1,80 @@
+#ifndef UTILS_MPSC_RING_H
+#define UTILS_MPSC_RING_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// ============================================================================
+// MPSC RING - Lock-free queue from any number of producers to one consumer
+// ============================================================================
+// Bounded queue with a sequence number per cell: producers claim a cell by
+// advancing the head with a CAS and publish it through the cell sequence,
+// so a producer never waits on another one and never blocks. pop() may
+// only be called from the consumer task. N must be a power of two.
+
+template <typename T, uint16_t N> class MpscRing {
+  static_assert(N >= 2 && N <= 16384 && (N & (N - 1)) == 0,
+                "N must be a power of two");
+
+public:
+  MpscRing() : _head(0), _tail(0) {
+    for (uint16_t i = 0; i < N; i++) {
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // Any task: false if the ring is full
+  bool push(const T &item) {
+    uint16_t pos = _head.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;) {
+      cell = &_cells[pos & (N - 1)];
+      uint16_t seq = cell->sequence.load(std::memory_order_acquire);
+      int16_t diff = (int16_t)(seq - pos);
+      if (diff == 0) {
+        if (_head.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false; // Consumer has not freed this cell yet
+      } else {
+        pos = _head.load(std::memory_order_relaxed);
+      }
+    }
+    cell->item = item;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: false if the ring is empty (or the oldest cell is still
+  // being written)
+  bool pop(T &item) {
+    uint16_t pos = _tail.load(std::memory_order_relaxed);
+    Cell &cell = _cells[pos & (N - 1)];
+    uint16_t seq = cell.sequence.load(std::memory_order_acquire);
+    if ((int16_t)(seq - (uint16_t)(pos + 1)) < 0)
+      return false;
+    item = cell.item;
+    cell.sequence.store(pos + N, std::memory_order_release);
+    _tail.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Consumer: nothing queued
+  bool isEmpty() {
+    return _tail.load(std::memory_order_relaxed) ==
+           _head.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Cell {
+    std::atomic<uint16_t> sequence;
+    T item;
+  };
+
+  Cell _cells[N];
+  std::atomic<uint16_t> _head; // Next cell to claim (producers)
+  std::atomic<uint16_t> _tail; // Next cell to read (consumer only)
+};
+
+#endif // UTILS_MPSC_RING_H
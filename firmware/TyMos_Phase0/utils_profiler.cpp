@@ -0,0 +1,132 @@
+#include "utils_profiler.h"
+#include "utils_logger.h"
+
+ProfilerClass Profiler;
+
+static const char *STAGE_NAMES[PROF_STAGE_COUNT] = {
+    "ctl_period", "ctl_loop", "wifi",       "ota",      "rtc",
+    "night",      "settings", "display",    "serial",   "mot_period",
+    "mot_step",   "mot_tick", "mot_i2c"};
+
+static uint8_t bucketIndex(uint32_t ticks) {
+  if (ticks < 4)
+    return ticks;
+  int e = 31 - __builtin_clz(ticks);
+  return (e - 1) * 4 + ((ticks >> (e - 2)) & 3);
+}
+
+// Largest value that falls in a bucket
+static uint64_t bucketUpper(uint8_t index) {
+  if (index < 4)
+    return index;
+  int e = index / 4 + 1;
+  uint64_t width = 1ULL << (e - 2);
+  return (4 + index % 4) * width + width - 1;
+}
+
+ProfilerClass::ProfilerClass() {
+  memset(_stages, 0, sizeof(_stages));
+  for (int i = 0; i < PROF_STAGE_COUNT; i++)
+    _resetPending[i] = false;
+  _ticksPerUs = 1;
+  _slowTicks = PROFILER_SLOW_STAGE_US;
+  _windowStart = 0;
+}
+
+void ProfilerClass::begin() {
+#ifdef ARDUINO_ARCH_ESP32
+  _ticksPerUs = getCpuFrequencyMhz();
+#else
+  _ticksPerUs = 1;
+#endif
+  _slowTicks = PROFILER_SLOW_STAGE_US * _ticksPerUs;
+  _windowStart = millis();
+}
+
+const char *ProfilerClass::stageName(uint8_t stage) {
+  return stage < PROF_STAGE_COUNT ? STAGE_NAMES[stage] : "unknown";
+}
+
+#if PROFILER_ENABLED
+void ProfilerClass::record(uint8_t stage, uint32_t ticks) {
+  if (stage >= PROF_STAGE_COUNT)
+    return;
+  ProfileStageStats &s = _stages[stage];
+  if (_resetPending[stage].load(std::memory_order_acquire)) {
+    memset(&s, 0, sizeof(s));
+    _resetPending[stage].store(false, std::memory_order_release);
+  }
+
+  // A new worst case past the threshold is worth a line right away (an NTP
+  // sync or flash write stalling the loop)
+  if (ticks >= _slowTicks && ticks > s.maxTicks)
+    Logger.warning("Slow %s: %lu us", STAGE_NAMES[stage],
+                   (unsigned long)_toUs(ticks));
+
+  s.count++;
+  s.totalTicks += ticks;
+  if (ticks > s.maxTicks)
+    s.maxTicks = ticks;
+  s.buckets[bucketIndex(ticks)]++;
+}
+#endif
+
+uint32_t ProfilerClass::_toUs(uint64_t ticks) {
+  return (uint32_t)(ticks / _ticksPerUs);
+}
+
+uint32_t ProfilerClass::_percentile(const ProfileStageStats &s,
+                                    uint32_t count, uint32_t pct) {
+  // Rank of the sample, rounded up; the bucket's upper edge, clamped to
+  // the real maximum
+  uint32_t rank = (uint32_t)(((uint64_t)count * pct + 99) / 100);
+  uint32_t seen = 0;
+  for (int i = 0; i < PROFILER_BUCKETS; i++) {
+    seen += s.buckets[i];
+    if (seen >= rank) {
+      uint64_t upper = bucketUpper(i);
+      return _toUs(upper < s.maxTicks ? upper : s.maxTicks);
+    }
+  }
+  return _toUs(s.maxTicks);
+}
+
+bool ProfilerClass::getSummary(uint8_t stage, ProfileSummary &summary) {
+  if (stage >= PROF_STAGE_COUNT)
+    return false;
+  const ProfileStageStats &s = _stages[stage];
+  // The owner may be recording meanwhile: take the count once
+  uint32_t count = s.count;
+  if (!count || _resetPending[stage])
+    return false;
+  summary.count = count;
+  summary.avgUs = _toUs(s.totalTicks / count);
+  summary.p50Us = _percentile(s, count, 50);
+  summary.p99Us = _percentile(s, count, 99);
+  summary.maxUs = _toUs(s.maxTicks);
+  return true;
+}
+
+void ProfilerClass::report() {
+  uint32_t now = millis();
+  Logger.info("Profile over the last %lu s (us):",
+              (unsigned long)((now - _windowStart) / 1000));
+  for (int i = 0; i < PROF_STAGE_COUNT; i++) {
+    ProfileSummary p;
+    if (!getSummary(i, p))
+      continue;
+    Logger.info("  %-10s n=%lu avg=%lu p50=%lu p99=%lu max=%lu",
+                STAGE_NAMES[i], (unsigned long)p.count,
+                (unsigned long)p.avgUs, (unsigned long)p.p50Us,
+                (unsigned long)p.p99Us, (unsigned long)p.maxUs);
+    _resetPending[i] = true;
+  }
+  _windowStart = now;
+}
+
+void ProfilerClass::update() {
+#if PROFILER_ENABLED && PROFILER_REPORT_INTERVAL_MS > 0
+  if (millis() - _windowStart >= PROFILER_REPORT_INTERVAL_MS)
+    report();
+#endif
+}
@@ -0,0 +1,111 @@
+#ifndef UTILS_PROFILER_H
+#define UTILS_PROFILER_H
+
+#include "config.h"
+#include <Arduino.h>
+#include <atomic>
+
+// ============================================================================
+// PROFILER - Per-stage loop timing
+// ============================================================================
+// Each stage of the control loop and the motion task is timed with the CPU
+// cycle counter (micros() on host builds) into a log-scaled histogram, four
+// buckets per power of two, so p50/p99 are within ~20%. A stage is only
+// recorded from one task; report() from another task reads it as it is and
+// asks the owner to start a new window on its next record().
+// PROFILER_ENABLED 0 compiles the calls to nothing.
+
+enum ProfileStage : uint8_t {
+  PROF_CONTROL_PERIOD, // Start to start of controlLoop()
+  PROF_CONTROL_LOOP,   // Whole controlLoop()
+  PROF_WIFI,           // wifiManager.update()
+  PROF_OTA,            // wifiManager.handleOTA()
+  PROF_RTC,            // rtcDriver.update()
+  PROF_NIGHT_MODE,     // checkNightMode()
+  PROF_SETTINGS,       // Settings.update()
+  PROF_DISPLAY,        // displayManager.update()
+  PROF_SERIAL,         // handleSerialCommands()
+  PROF_MOTION_PERIOD,  // Start to start of MotionTask::step()
+  PROF_MOTION_STEP,    // Whole MotionTask::step()
+  PROF_MOTION_TICK,    // MotionEngine::tick()
+  PROF_MOTION_I2C,     // I2CBus.update() (completions)
+  PROF_STAGE_COUNT
+};
+
+// 0..3 exact, then 4 per power of two up to 2^32 ticks
+#define PROFILER_BUCKETS 124
+
+struct ProfileStageStats {
+  uint32_t count;
+  uint32_t maxTicks;
+  uint64_t totalTicks;
+  uint32_t buckets[PROFILER_BUCKETS];
+};
+
+// One stage's window, in microseconds
+struct ProfileSummary {
+  uint32_t count;
+  uint32_t avgUs;
+  uint32_t p50Us;
+  uint32_t p99Us;
+  uint32_t maxUs;
+};
+
+class ProfilerClass {
+public:
+  ProfilerClass();
+
+  // Reads the CPU frequency; call once in setup()
+  void begin();
+
+#if PROFILER_ENABLED
+  // Timestamp in ticks (CPU cycles, or microseconds on host builds). Only
+  // compare timestamps taken on the same core.
+  static uint32_t now() {
+#ifdef ARDUINO_ARCH_ESP32
+    return ESP.getCycleCount();
+#else
+    return (uint32_t)micros();
+#endif
+  }
+
+  void record(uint8_t stage, uint32_t ticks);
+
+  // Record the time since `since` and return the new timestamp, so a
+  // sequence of stages reads the counter once per stage
+  uint32_t lap(uint8_t stage, uint32_t since) {
+    uint32_t t = now();
+    record(stage, t - since);
+    return t;
+  }
+#else
+  static uint32_t now() { return 0; }
+  void record(uint8_t, uint32_t) {}
+  uint32_t lap(uint8_t, uint32_t) { return 0; }
+#endif
+
+  // Current window of a stage. False if nothing was recorded yet.
+  bool getSummary(uint8_t stage, ProfileSummary &summary);
+  static const char *stageName(uint8_t stage);
+
+  // Log every stage and start a new window
+  void report();
+
+  // Periodic report every PROFILER_REPORT_INTERVAL_MS (control task)
+  void update();
+
+private:
+  ProfileStageStats _stages[PROF_STAGE_COUNT];
+  std::atomic<bool> _resetPending[PROF_STAGE_COUNT];
+  uint32_t _ticksPerUs;
+  uint32_t _slowTicks;
+  uint32_t _windowStart;
+
+  uint32_t _toUs(uint64_t ticks);
+  uint32_t _percentile(const ProfileStageStats &s, uint32_t count,
+                       uint32_t pct);
+};
+
+extern ProfilerClass Profiler;
+
+#endif // UTILS_PROFILER_H
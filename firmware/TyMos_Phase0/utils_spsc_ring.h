@@ -0,0 +1,47 @@
+#ifndef UTILS_SPSC_RING_H
+#define UTILS_SPSC_RING_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// ============================================================================
+// SPSC RING - Lock-free queue between exactly one producer and one consumer
+// ============================================================================
+// push() may only be called from the producer task and pop() from the
+// consumer task. N must be a power of two.
+
+template <typename T, uint16_t N> class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+  SpscRing() : _head(0), _tail(0) {}
+
+  // Producer: false if the ring is full
+  bool push(const T &item) {
+    uint16_t head = _head.load(std::memory_order_relaxed);
+    uint16_t tail = _tail.load(std::memory_order_acquire);
+    if ((uint16_t)(head - tail) == N)
+      return false;
+    _items[head & (N - 1)] = item;
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: false if the ring is empty
+  bool pop(T &item) {
+    uint16_t tail = _tail.load(std::memory_order_relaxed);
+    uint16_t head = _head.load(std::memory_order_acquire);
+    if (head == tail)
+      return false;
+    item = _items[tail & (N - 1)];
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  T _items[N];
+  std::atomic<uint16_t> _head; // Written by the producer only
+  std::atomic<uint16_t> _tail; // Written by the consumer only
+};
+
+#endif // UTILS_SPSC_RING_H
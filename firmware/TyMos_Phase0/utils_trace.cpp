@@ -0,0 +1,75 @@
+#include "utils_trace.h"
+
+static_assert((TRACE_BUFFER_EVENTS & (TRACE_BUFFER_EVENTS - 1)) == 0,
+              "TRACE_BUFFER_EVENTS must be a power of two");
+
+TraceClass Trace;
+
+static const char *TYPE_NAMES[TRACE_EVENT_COUNT] = {
+    "servo_angle", "servo_pulse",    "servo_detach", "pwm_set",
+    "i2c_begin",   "i2c_end",        "rtc_now",      "collision_plan",
+    "phase_begin", "phase_end",      "move_start",   "move_end"};
+
+TraceClass::TraceClass() {
+  _next = 0;
+  _enabled = false;
+}
+
+void TraceClass::enable(bool on) { _enabled = on; }
+
+void TraceClass::record(uint8_t type, uint8_t a, uint16_t b, uint32_t c) {
+  uint32_t slot = _next.fetch_add(1, std::memory_order_relaxed);
+  TraceEvent &e = _events[slot & (TRACE_BUFFER_EVENTS - 1)];
+  e.timeUs = (uint32_t)micros();
+  e.type = type;
+  e.a = a;
+  e.b = b;
+  e.c = c;
+}
+
+void TraceClass::clear() { _next = 0; }
+
+uint32_t TraceClass::total() { return _next; }
+
+uint16_t TraceClass::count() {
+  uint32_t n = _next;
+  return n < TRACE_BUFFER_EVENTS ? n : TRACE_BUFFER_EVENTS;
+}
+
+bool TraceClass::get(uint16_t index, TraceEvent &event) {
+  uint32_t n = _next;
+  uint16_t available = n < TRACE_BUFFER_EVENTS ? n : TRACE_BUFFER_EVENTS;
+  if (index >= available)
+    return false;
+  event = _events[(n - available + index) & (TRACE_BUFFER_EVENTS - 1)];
+  return true;
+}
+
+const char *TraceClass::typeName(uint8_t type) {
+  return type < TRACE_EVENT_COUNT ? TYPE_NAMES[type] : "unknown";
+}
+
+int TraceClass::format(const TraceEvent &event, char *buffer, size_t size) {
+  return snprintf(buffer, size, "T %lu %s %u %u %lu",
+                  (unsigned long)event.timeUs, typeName(event.type), event.a,
+                  event.b, (unsigned long)event.c);
+}
+
+void TraceClass::dump() {
+  bool wasEnabled = _enabled;
+  _enabled = false;
+
+  char line[64];
+  uint16_t n = count();
+  snprintf(line, sizeof(line), "# tymos-trace v1 events=%u lost=%lu", n,
+           (unsigned long)(total() - n));
+  Serial.println(line);
+  TraceEvent e;
+  for (uint16_t i = 0; i < n && get(i, e); i++) {
+    format(e, line, sizeof(line));
+    Serial.println(line);
+  }
+  Serial.println("# end");
+
+  _enabled = wasEnabled;
+}
@@ -0,0 +1,91 @@
+#ifndef UTILS_TRACE_H
+#define UTILS_TRACE_H
+
+#include "config.h"
+#include <Arduino.h>
+#include <atomic>
+
+// ============================================================================
+// TRACE - Hot-path event recorder
+// ============================================================================
+// Fixed-size binary events with a micros() timestamp, written into a ring
+// that keeps the newest TRACE_BUFFER_EVENTS. Recording is off until
+// enable(); while off a TRACE_EVENT costs one relaxed load and a branch,
+// and TRACE_ENABLED 0 compiles the hooks out. dump() prints the ring as
+// text lines that host-sim/tools/trace_timeline.py turns into a timeline.
+
+enum TraceEventType : uint8_t {
+  TRACE_SERVO_ANGLE,    // a=board, b=channel, c=angle
+  TRACE_SERVO_PULSE,    // a=board, b=channel, c=12-bit count
+  TRACE_SERVO_DETACH,   // a=board, b=channel
+  TRACE_PWM_SET,        // a=board, b=channel, c=off count (changes only)
+  TRACE_I2C_BEGIN,      // a=address, b=priority, c=tag
+  TRACE_I2C_END,        // a=address, b=priority, c=result
+  TRACE_RTC_NOW,        // c=unix time (only when the cached second changes)
+  TRACE_COLLISION_PLAN, // a=digit, b=from << 8 | to, c=moves
+  TRACE_PHASE_BEGIN,    // a=lane, b=phase
+  TRACE_PHASE_END,      // a=lane, b=phase
+  TRACE_MOVE_START,     // a=lane, b=board << 8 | channel, c=duration ms
+  TRACE_MOVE_END,       // a=lane, b=board << 8 | channel
+  TRACE_EVENT_COUNT
+};
+
+struct TraceEvent {
+  uint32_t timeUs;
+  uint8_t type; // TraceEventType
+  uint8_t a;
+  uint16_t b;
+  uint32_t c;
+};
+
+class TraceClass {
+public:
+  TraceClass();
+
+  void enable(bool on);
+  bool isEnabled() {
+    return _enabled.load(std::memory_order_relaxed);
+  }
+
+  // Any task. Concurrent writers never wait; a dump taken while recording
+  // may show a torn event.
+  void record(uint8_t type, uint8_t a, uint16_t b, uint32_t c);
+
+  // Forget all events
+  void clear();
+
+  // Events recorded since clear(), including overwritten ones
+  uint32_t total();
+
+  // Events still in the ring, oldest first (index 0 = oldest)
+  uint16_t count();
+  bool get(uint16_t index, TraceEvent &event);
+
+  // One dump line for an event, without newline
+  static int format(const TraceEvent &event, char *buffer, size_t size);
+  static const char *typeName(uint8_t type);
+
+  // Print the ring over Serial (pauses recording while printing)
+  void dump();
+
+private:
+  TraceEvent _events[TRACE_BUFFER_EVENTS];
+  std::atomic<uint32_t> _next;
+  std::atomic<bool> _enabled;
+};
+
+extern TraceClass Trace;
+
+#if TRACE_ENABLED
+#define TRACE_EVENT(type, a, b, c)                                             \
+  do {                                                                         \
+    if (Trace.isEnabled())                                                     \
+      Trace.record((type), (a), (b), (c));                                     \
+  } while (0)
+#else
+#define TRACE_EVENT(type, a, b, c)                                             \
+  do {                                                                         \
+  } while (0)
+#endif
+
+#endif // UTILS_TRACE_H
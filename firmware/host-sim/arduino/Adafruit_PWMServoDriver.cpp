@@ -0,0 +1,91 @@
+#include "Adafruit_PWMServoDriver.h"
+
+Adafruit_PWMServoDriver::Adafruit_PWMServoDriver(const uint8_t addr,
+                                                 TwoWire &i2c) {
+  _addr = addr;
+  _i2c = &i2c;
+  _oscillatorFreq = FREQUENCY_OSCILLATOR;
+}
+
+bool Adafruit_PWMServoDriver::begin(uint8_t prescale) {
+  reset();
+  (void)prescale;
+  setPWMFreq(1000);
+  return true;
+}
+
+void Adafruit_PWMServoDriver::reset() {
+  _write8(PCA9685_MODE1, MODE1_RESTART);
+  delay(10);
+}
+
+void Adafruit_PWMServoDriver::sleep() {
+  _write8(PCA9685_MODE1, _read8(PCA9685_MODE1) | MODE1_SLEEP);
+  delay(5);
+}
+
+void Adafruit_PWMServoDriver::wakeup() {
+  _write8(PCA9685_MODE1, _read8(PCA9685_MODE1) & ~MODE1_SLEEP);
+}
+
+void Adafruit_PWMServoDriver::setPWMFreq(float freq) {
+  if (freq < 1)
+    freq = 1;
+  if (freq > 3500)
+    freq = 3500;
+
+  float prescaleval = ((_oscillatorFreq / (freq * 4096.0)) + 0.5) - 1;
+  if (prescaleval < PCA9685_PRESCALE_MIN)
+    prescaleval = PCA9685_PRESCALE_MIN;
+  if (prescaleval > PCA9685_PRESCALE_MAX)
+    prescaleval = PCA9685_PRESCALE_MAX;
+  uint8_t prescale = (uint8_t)prescaleval;
+
+  uint8_t oldmode = _read8(PCA9685_MODE1);
+  uint8_t newmode = (oldmode & ~MODE1_RESTART) | MODE1_SLEEP;
+  _write8(PCA9685_MODE1, newmode);
+  _write8(PCA9685_PRESCALE, prescale);
+  _write8(PCA9685_MODE1, oldmode);
+  delay(5);
+  _write8(PCA9685_MODE1, oldmode | MODE1_RESTART | MODE1_AI);
+}
+
+uint8_t Adafruit_PWMServoDriver::setPWM(uint8_t num, uint16_t on,
+                                        uint16_t off) {
+  _i2c->beginTransmission(_addr);
+  _i2c->write(PCA9685_LED0_ON_L + 4 * num);
+  _i2c->write(on);
+  _i2c->write(on >> 8);
+  _i2c->write(off);
+  _i2c->write(off >> 8);
+  return _i2c->endTransmission();
+}
+
+uint16_t Adafruit_PWMServoDriver::getPWM(uint8_t num, bool off) {
+  _i2c->beginTransmission(_addr);
+  _i2c->write(PCA9685_LED0_ON_L + 4 * num + (off ? 2 : 0));
+  _i2c->endTransmission();
+  _i2c->requestFrom(_addr, (uint8_t)2);
+  uint16_t low = _i2c->read();
+  uint16_t high = _i2c->read();
+  return low | (high << 8);
+}
+
+uint8_t Adafruit_PWMServoDriver::readPrescale() {
+  return _read8(PCA9685_PRESCALE);
+}
+
+uint8_t Adafruit_PWMServoDriver::_read8(uint8_t reg) {
+  _i2c->beginTransmission(_addr);
+  _i2c->write(reg);
+  _i2c->endTransmission();
+  _i2c->requestFrom(_addr, (uint8_t)1);
+  return _i2c->read();
+}
+
+void Adafruit_PWMServoDriver::_write8(uint8_t reg, uint8_t value) {
+  _i2c->beginTransmission(_addr);
+  _i2c->write(reg);
+  _i2c->write(value);
+  _i2c->endTransmission();
+}
@@ -0,0 +1,54 @@
+#ifndef ADAFRUIT_PWMSERVODRIVER_H
+#define ADAFRUIT_PWMSERVODRIVER_H
+
+// ============================================================================
+// ADAFRUIT PCA9685 SHIM - Same register traffic as the real library
+// ============================================================================
+
+#include "Arduino.h"
+#include "Wire.h"
+
+// REGISTER ADDRESSES
+#define PCA9685_MODE1 0x00
+#define PCA9685_MODE2 0x01
+#define PCA9685_LED0_ON_L 0x06
+#define PCA9685_ALLLED_ON_L 0xFA
+#define PCA9685_PRESCALE 0xFE
+
+// MODE1 bits
+#define MODE1_ALLCAL 0x01
+#define MODE1_SLEEP 0x10
+#define MODE1_AI 0x20
+#define MODE1_EXTCLK 0x40
+#define MODE1_RESTART 0x80
+
+#define PCA9685_I2C_ADDRESS 0x40
+#define FREQUENCY_OSCILLATOR 25000000
+#define PCA9685_PRESCALE_MIN 3
+#define PCA9685_PRESCALE_MAX 255
+
+class Adafruit_PWMServoDriver {
+public:
+  Adafruit_PWMServoDriver(const uint8_t addr = PCA9685_I2C_ADDRESS,
+                          TwoWire &i2c = Wire);
+
+  bool begin(uint8_t prescale = 0);
+  void reset();
+  void sleep();
+  void wakeup();
+  void setPWMFreq(float freq);
+  uint8_t setPWM(uint8_t num, uint16_t on, uint16_t off);
+  uint16_t getPWM(uint8_t num, bool off = false);
+  uint8_t readPrescale();
+  void setOscillatorFrequency(uint32_t freq) { _oscillatorFreq = freq; }
+
+private:
+  uint8_t _addr;
+  TwoWire *_i2c;
+  uint32_t _oscillatorFreq;
+
+  uint8_t _read8(uint8_t reg);
+  void _write8(uint8_t reg, uint8_t value);
+};
+
+#endif // ADAFRUIT_PWMSERVODRIVER_H
@@ -0,0 +1,50 @@
+#include "Arduino.h"
+#include "sim_clock.h"
+
+HardwareSerial Serial;
+
+uint64_t SimClock::_nowUs = 0;
+
+uint64_t SimClock::nowUs() { return _nowUs; }
+
+void SimClock::advanceUs(uint64_t us) { _nowUs += us; }
+
+void SimClock::reset() { _nowUs = 0; }
+
+unsigned long millis() { return (unsigned long)(SimClock::nowUs() / 1000ULL); }
+
+unsigned long micros() { return (unsigned long)SimClock::nowUs(); }
+
+void delay(unsigned long ms) { SimClock::advanceMs(ms); }
+
+void delayMicroseconds(unsigned int us) { SimClock::advanceUs(us); }
+
+void yield() {}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+void HardwareSerial::begin(unsigned long baud) { (void)baud; }
+
+size_t HardwareSerial::print(const char *str) {
+  if (_echo)
+    fputs(str, stdout);
+  return strlen(str);
+}
+
+size_t HardwareSerial::println(const char *str) {
+  if (_echo) {
+    fputs(str, stdout);
+    fputc('\n', stdout);
+  }
+  return strlen(str) + 1;
+}
+
+size_t HardwareSerial::printf(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int n = _echo ? vprintf(format, args) : vsnprintf(NULL, 0, format, args);
+  va_end(args);
+  return n < 0 ? 0 : (size_t)n;
+}
@@ -0,0 +1,48 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+// ============================================================================
+// ARDUINO SHIM - Minimal Arduino core for host simulation builds
+// ============================================================================
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define F(str) (str)
+#define PROGMEM
+
+// Time (virtual, see sim_clock.h)
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+// Serial: prints to stdout, can be muted for long simulations
+class HardwareSerial {
+public:
+  void begin(unsigned long baud);
+  size_t print(const char *str);
+  size_t println(const char *str = "");
+  size_t printf(const char *format, ...);
+
+  void setEcho(bool enabled) { _echo = enabled; }
+  bool echo() const { return _echo; }
+
+private:
+  bool _echo = true;
+};
+
+extern HardwareSerial Serial;
+
+#endif // ARDUINO_H
@@ -0,0 +1,123 @@
+#include "Preferences.h"
+#include <map>
+#include <string>
+#include <vector>
+
+typedef std::map<std::string, std::vector<uint8_t>> SimNamespace;
+
+static std::map<std::string, SimNamespace> &simFlash() {
+  static std::map<std::string, SimNamespace> flash;
+  return flash;
+}
+
+static uint32_t simWrites = 0;
+
+bool Preferences::begin(const char *name, bool readOnly) {
+  if (!name || strlen(name) >= sizeof(_namespace))
+    return false;
+  strncpy(_namespace, name, sizeof(_namespace) - 1);
+  _open = true;
+  _readOnly = readOnly;
+  return true;
+}
+
+void Preferences::end() { _open = false; }
+
+bool Preferences::clear() {
+  if (!_open || _readOnly)
+    return false;
+  simFlash()[_namespace].clear();
+  simWrites++;
+  return true;
+}
+
+bool Preferences::remove(const char *key) {
+  if (!_open || _readOnly)
+    return false;
+  simWrites++;
+  return simFlash()[_namespace].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char *key) {
+  if (!_open)
+    return false;
+  SimNamespace &ns = simFlash()[_namespace];
+  return ns.find(key) != ns.end();
+}
+
+size_t Preferences::_put(const char *key, const void *value, size_t len) {
+  if (!_open || _readOnly)
+    return 0;
+  const uint8_t *bytes = (const uint8_t *)value;
+  simFlash()[_namespace][key].assign(bytes, bytes + len);
+  simWrites++;
+  return len;
+}
+
+size_t Preferences::_get(const char *key, void *buf, size_t len) {
+  if (!_open)
+    return 0;
+  SimNamespace &ns = simFlash()[_namespace];
+  SimNamespace::iterator it = ns.find(key);
+  if (it == ns.end() || it->second.size() > len)
+    return 0;
+  memcpy(buf, it->second.data(), it->second.size());
+  return it->second.size();
+}
+
+size_t Preferences::putUChar(const char *key, uint8_t value) {
+  return _put(key, &value, sizeof(value));
+}
+
+size_t Preferences::putUShort(const char *key, uint16_t value) {
+  return _put(key, &value, sizeof(value));
+}
+
+size_t Preferences::putUInt(const char *key, uint32_t value) {
+  return _put(key, &value, sizeof(value));
+}
+
+size_t Preferences::putBool(const char *key, bool value) {
+  uint8_t v = value ? 1 : 0;
+  return _put(key, &v, sizeof(v));
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+  return _put(key, value, len);
+}
+
+uint8_t Preferences::getUChar(const char *key, uint8_t defaultValue) {
+  uint8_t v;
+  return _get(key, &v, sizeof(v)) == sizeof(v) ? v : defaultValue;
+}
+
+uint16_t Preferences::getUShort(const char *key, uint16_t defaultValue) {
+  uint16_t v;
+  return _get(key, &v, sizeof(v)) == sizeof(v) ? v : defaultValue;
+}
+
+uint32_t Preferences::getUInt(const char *key, uint32_t defaultValue) {
+  uint32_t v;
+  return _get(key, &v, sizeof(v)) == sizeof(v) ? v : defaultValue;
+}
+
+bool Preferences::getBool(const char *key, bool defaultValue) {
+  uint8_t v;
+  return _get(key, &v, sizeof(v)) == sizeof(v) ? v != 0 : defaultValue;
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+  if (!_open)
+    return 0;
+  SimNamespace &ns = simFlash()[_namespace];
+  SimNamespace::iterator it = ns.find(key);
+  return it == ns.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+  return _get(key, buf, maxLen);
+}
+
+uint32_t Preferences::writeCount() { return simWrites; }
+
+void Preferences::eraseAll() { simFlash().clear(); }
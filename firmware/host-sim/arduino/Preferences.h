@@ -0,0 +1,47 @@
+#ifndef PREFERENCES_H
+#define PREFERENCES_H
+
+// ============================================================================
+// PREFERENCES SHIM - In-memory NVS for host simulation builds
+// ============================================================================
+// Namespaces survive end()/begin() for the lifetime of the process, like a
+// reboot that keeps flash contents.
+
+#include "Arduino.h"
+
+class Preferences {
+public:
+  bool begin(const char *name, bool readOnly = false);
+  void end();
+
+  bool clear();
+  bool remove(const char *key);
+  bool isKey(const char *key);
+
+  size_t putUChar(const char *key, uint8_t value);
+  size_t putUShort(const char *key, uint16_t value);
+  size_t putUInt(const char *key, uint32_t value);
+  size_t putBool(const char *key, bool value);
+  size_t putBytes(const char *key, const void *value, size_t len);
+
+  uint8_t getUChar(const char *key, uint8_t defaultValue = 0);
+  uint16_t getUShort(const char *key, uint16_t defaultValue = 0);
+  uint32_t getUInt(const char *key, uint32_t defaultValue = 0);
+  bool getBool(const char *key, bool defaultValue = false);
+  size_t getBytesLength(const char *key);
+  size_t getBytes(const char *key, void *buf, size_t maxLen);
+
+  // Simulation hooks
+  static uint32_t writeCount(); // Number of put*/remove/clear commits
+  static void eraseAll();       // Wipe every namespace
+
+private:
+  char _namespace[16] = {0};
+  bool _open = false;
+  bool _readOnly = false;
+
+  size_t _put(const char *key, const void *value, size_t len);
+  size_t _get(const char *key, void *buf, size_t len);
+};
+
+#endif // PREFERENCES_H
@@ -0,0 +1,173 @@
+#include "RTClib.h"
+
+static const uint8_t daysInMonth[] = {31, 28, 31, 30, 31, 30,
+                                      31, 31, 30, 31, 30};
+
+static uint16_t date2days(uint16_t y, uint8_t m, uint8_t d) {
+  if (y >= 2000U)
+    y -= 2000U;
+  uint16_t days = d;
+  for (uint8_t i = 1; i < m; ++i)
+    days += daysInMonth[i - 1];
+  if (m > 2 && y % 4 == 0)
+    ++days;
+  return days + 365 * y + (y + 3) / 4 - 1;
+}
+
+static uint8_t conv2d(const char *p) {
+  uint8_t v = 0;
+  if ('0' <= *p && *p <= '9')
+    v = *p - '0';
+  return 10 * v + *++p - '0';
+}
+
+static uint8_t bcd2bin(uint8_t val) { return val - 6 * (val >> 4); }
+static uint8_t bin2bcd(uint8_t val) { return val + 6 * (val / 10); }
+
+DateTime::DateTime(uint32_t t) {
+  t -= SECONDS_FROM_1970_TO_2000;
+  ss = t % 60;
+  t /= 60;
+  mm = t % 60;
+  t /= 60;
+  hh = t % 24;
+  uint16_t days = t / 24;
+  uint8_t leap;
+  for (yOff = 0;; ++yOff) {
+    leap = yOff % 4 == 0;
+    if (days < 365U + leap)
+      break;
+    days -= 365 + leap;
+  }
+  for (m = 1; m < 12; ++m) {
+    uint8_t daysPerMonth = daysInMonth[m - 1];
+    if (leap && m == 2)
+      ++daysPerMonth;
+    if (days < daysPerMonth)
+      break;
+    days -= daysPerMonth;
+  }
+  d = days + 1;
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour,
+                   uint8_t min, uint8_t sec) {
+  if (year >= 2000U)
+    year -= 2000U;
+  yOff = year;
+  m = month;
+  d = day;
+  hh = hour;
+  mm = min;
+  ss = sec;
+}
+
+DateTime::DateTime(const char *date, const char *time) {
+  yOff = conv2d(date + 9);
+  switch (date[0]) {
+  case 'J':
+    m = (date[1] == 'a') ? 1 : ((date[2] == 'n') ? 6 : 7);
+    break;
+  case 'F':
+    m = 2;
+    break;
+  case 'A':
+    m = date[2] == 'r' ? 4 : 8;
+    break;
+  case 'M':
+    m = date[2] == 'r' ? 3 : 5;
+    break;
+  case 'S':
+    m = 9;
+    break;
+  case 'O':
+    m = 10;
+    break;
+  case 'N':
+    m = 11;
+    break;
+  case 'D':
+  default:
+    m = 12;
+    break;
+  }
+  d = conv2d(date + 4);
+  hh = conv2d(time);
+  mm = conv2d(time + 3);
+  ss = conv2d(time + 6);
+}
+
+uint8_t DateTime::dayOfTheWeek() const {
+  uint16_t day = date2days(yOff, m, d);
+  return (day + 6) % 7; // Jan 1, 2000 is a Saturday
+}
+
+uint32_t DateTime::unixtime() const {
+  uint16_t days = date2days(yOff, m, d);
+  uint32_t t = ((days * 24UL + hh) * 60 + mm) * 60 + ss;
+  return t + SECONDS_FROM_1970_TO_2000;
+}
+
+bool RTC_DS3231::begin(TwoWire *wireInstance) {
+  _wire = wireInstance;
+  _wire->beginTransmission(DS3231_ADDRESS);
+  return _wire->endTransmission() == 0;
+}
+
+void RTC_DS3231::adjust(const DateTime &dt) {
+  _wire->beginTransmission(DS3231_ADDRESS);
+  _wire->write(DS3231_TIME);
+  _wire->write(bin2bcd(dt.second()));
+  _wire->write(bin2bcd(dt.minute()));
+  _wire->write(bin2bcd(dt.hour()));
+  _wire->write(bin2bcd(dt.dayOfTheWeek() ? dt.dayOfTheWeek() : 7));
+  _wire->write(bin2bcd(dt.day()));
+  _wire->write(bin2bcd(dt.month()));
+  _wire->write(bin2bcd(dt.year() - 2000U));
+  _wire->endTransmission();
+
+  // Clear the oscillator stop flag
+  _write8(DS3231_STATUSREG, _read8(DS3231_STATUSREG) & ~0x80);
+}
+
+bool RTC_DS3231::lostPower() { return _read8(DS3231_STATUSREG) >> 7; }
+
+DateTime RTC_DS3231::now() {
+  uint8_t buffer[7];
+  _wire->beginTransmission(DS3231_ADDRESS);
+  _wire->write(DS3231_TIME);
+  _wire->endTransmission();
+  _wire->requestFrom((uint8_t)DS3231_ADDRESS, (uint8_t)7);
+  for (int i = 0; i < 7; i++)
+    buffer[i] = _wire->read();
+
+  return DateTime(bcd2bin(buffer[6]) + 2000U, bcd2bin(buffer[5] & 0x7F),
+                  bcd2bin(buffer[4]), bcd2bin(buffer[2]), bcd2bin(buffer[1]),
+                  bcd2bin(buffer[0] & 0x7F));
+}
+
+float RTC_DS3231::getTemperature() {
+  uint8_t buffer[2];
+  _wire->beginTransmission(DS3231_ADDRESS);
+  _wire->write(DS3231_TEMPERATUREREG);
+  _wire->endTransmission();
+  _wire->requestFrom((uint8_t)DS3231_ADDRESS, (uint8_t)2);
+  buffer[0] = _wire->read();
+  buffer[1] = _wire->read();
+  return (float)(int8_t)buffer[0] + (buffer[1] >> 6) * 0.25f;
+}
+
+uint8_t RTC_DS3231::_read8(uint8_t reg) {
+  _wire->beginTransmission(DS3231_ADDRESS);
+  _wire->write(reg);
+  _wire->endTransmission();
+  _wire->requestFrom((uint8_t)DS3231_ADDRESS, (uint8_t)1);
+  return _wire->read();
+}
+
+void RTC_DS3231::_write8(uint8_t reg, uint8_t value) {
+  _wire->beginTransmission(DS3231_ADDRESS);
+  _wire->write(reg);
+  _wire->write(value);
+  _wire->endTransmission();
+}
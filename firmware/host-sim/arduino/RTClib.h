@@ -0,0 +1,78 @@
+#ifndef RTCLIB_H
+#define RTCLIB_H
+
+// ============================================================================
+// RTCLIB SHIM - DateTime and a DS3231 driver talking to the mock Wire bus
+// ============================================================================
+
+#include "Arduino.h"
+#include "Wire.h"
+
+#define DS3231_ADDRESS 0x68
+#define DS3231_TIME 0x00
+#define DS3231_STATUSREG 0x0F
+#define DS3231_TEMPERATUREREG 0x11
+
+#define SECONDS_FROM_1970_TO_2000 946684800
+
+class TimeSpan {
+public:
+  TimeSpan(int32_t seconds = 0) : _seconds(seconds) {}
+  TimeSpan(int16_t days, int8_t hours, int8_t minutes, int8_t seconds)
+      : _seconds((int32_t)days * 86400L + (int32_t)hours * 3600 +
+                 (int32_t)minutes * 60 + seconds) {}
+  int32_t totalseconds() const { return _seconds; }
+
+private:
+  int32_t _seconds;
+};
+
+class DateTime {
+public:
+  DateTime(uint32_t t = SECONDS_FROM_1970_TO_2000);
+  DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0,
+           uint8_t min = 0, uint8_t sec = 0);
+  // From __DATE__ ("Mmm dd yyyy") and __TIME__ ("hh:mm:ss")
+  DateTime(const char *date, const char *time);
+
+  uint16_t year() const { return 2000U + yOff; }
+  uint8_t month() const { return m; }
+  uint8_t day() const { return d; }
+  uint8_t hour() const { return hh; }
+  uint8_t minute() const { return mm; }
+  uint8_t second() const { return ss; }
+  uint8_t dayOfTheWeek() const;
+  uint32_t unixtime() const;
+
+  DateTime operator+(const TimeSpan &span) const {
+    return DateTime(unixtime() + span.totalseconds());
+  }
+  DateTime operator-(const TimeSpan &span) const {
+    return DateTime(unixtime() - span.totalseconds());
+  }
+
+protected:
+  uint8_t yOff; // Year offset from 2000
+  uint8_t m;
+  uint8_t d;
+  uint8_t hh;
+  uint8_t mm;
+  uint8_t ss;
+};
+
+class RTC_DS3231 {
+public:
+  bool begin(TwoWire *wireInstance = &Wire);
+  void adjust(const DateTime &dt);
+  bool lostPower();
+  DateTime now();
+  float getTemperature();
+
+private:
+  TwoWire *_wire = &Wire;
+
+  uint8_t _read8(uint8_t reg);
+  void _write8(uint8_t reg, uint8_t value);
+};
+
+#endif // RTCLIB_H
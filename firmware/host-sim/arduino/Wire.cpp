@@ -0,0 +1,178 @@
+#include "Wire.h"
+#include "sim_clock.h"
+
+TwoWire Wire;
+
+TwoWire::TwoWire() {
+  _deviceCount = 0;
+  _clock = 100000;
+  _timeoutMs = 50;
+  _faultSeed = 0x2545F491;
+  _glitches = 0;
+  _hung = false;
+  _txAddress = 0;
+  _txLength = 0;
+  _txOverflow = false;
+  _rxLength = 0;
+  _rxIndex = 0;
+  _tap = NULL;
+  resetStats();
+}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+  (void)sda;
+  (void)scl;
+  if (frequency)
+    _clock = frequency;
+  return true;
+}
+
+bool TwoWire::end() {
+  // Re-initializing the controller after clocking the bus free (the
+  // firmware's recovery) releases a hung bus
+  _hung = false;
+  return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency) {
+  _clock = frequency;
+  return true;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  _txAddress = address;
+  _txLength = 0;
+  _txOverflow = false;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (_txLength >= I2C_BUFFER_LENGTH) {
+    _txOverflow = true;
+    return 0;
+  }
+  _txBuffer[_txLength++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t len) {
+  size_t n = 0;
+  while (n < len && write(data[n]))
+    n++;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+  (void)sendStop;
+  if (_txOverflow)
+    return 1;
+
+  uint64_t startUs = SimClock::nowUs();
+  uint8_t fault = _fault();
+  if (fault == 5) {
+    if (_tap)
+      _tap->onTransaction(startUs, _txAddress, false, _txBuffer, 0, false);
+    return 5;
+  }
+  _account(_txLength);
+  SimI2CDevice *device = _find(_txAddress);
+  bool acked = !fault && device && device->onWrite(_txBuffer, _txLength);
+  if (_tap)
+    _tap->onTransaction(startUs, _txAddress, false, _txBuffer, _txLength,
+                        acked);
+  if (!acked) {
+    _stats.nacks++;
+    return device ? 3 : 2;
+  }
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity,
+                             bool sendStop) {
+  (void)sendStop;
+  _rxLength = 0;
+  _rxIndex = 0;
+  if (quantity > I2C_BUFFER_LENGTH)
+    quantity = I2C_BUFFER_LENGTH;
+
+  uint64_t startUs = SimClock::nowUs();
+  uint8_t fault = _fault();
+  if (fault == 5) {
+    if (_tap)
+      _tap->onTransaction(startUs, address, true, _rxBuffer, 0, false);
+    return 0;
+  }
+  _account(quantity);
+  SimI2CDevice *device = fault ? NULL : _find(address);
+  if (device)
+    _rxLength = device->onRead(_rxBuffer, quantity);
+  if (_tap)
+    _tap->onTransaction(startUs, address, true, _rxBuffer, _rxLength,
+                        device != NULL);
+  if (!device) {
+    _stats.nacks++;
+    return 0;
+  }
+  return (uint8_t)_rxLength;
+}
+
+int TwoWire::available() { return (int)(_rxLength - _rxIndex); }
+
+int TwoWire::read() {
+  if (_rxIndex >= _rxLength)
+    return -1;
+  return _rxBuffer[_rxIndex++];
+}
+
+void TwoWire::attach(SimI2CDevice *device) {
+  if (_deviceCount < SIM_I2C_MAX_DEVICES)
+    _devices[_deviceCount++] = device;
+}
+
+void TwoWire::detachAll() { _deviceCount = 0; }
+
+void TwoWire::resetStats() { memset(&_stats, 0, sizeof(_stats)); }
+
+SimI2CDevice *TwoWire::_find(uint8_t address) {
+  for (uint8_t i = 0; i < _deviceCount; i++) {
+    if (_devices[i]->address() == address)
+      return _devices[i];
+  }
+  return NULL;
+}
+
+uint8_t TwoWire::_fault() {
+  if (!_hung && _faults.glitchPpm) {
+    // xorshift32: the same faults on every run
+    _faultSeed ^= _faultSeed << 13;
+    _faultSeed ^= _faultSeed >> 17;
+    _faultSeed ^= _faultSeed << 5;
+    if (_faultSeed % 1000000 < _faults.glitchPpm) {
+      if (++_glitches % 2 == 0)
+        _hung = true;
+      else
+        return 3;
+    }
+  }
+  if (_hung) {
+    // The controller gives up after its timeout
+    _stats.transactions++;
+    _stats.timeouts++;
+    _stats.busTimeUs += _timeoutMs * 1000ULL;
+    SimClock::advanceMs(_timeoutMs);
+    return 5;
+  }
+  if (_faults.maxClock && _clock > _faults.maxClock)
+    return 3; // Edges too slow for this clock: corrupted bits
+  return 0;
+}
+
+void TwoWire::_account(size_t payloadBytes) {
+  // START + address byte + payload bytes (9 clocks each) + STOP
+  uint64_t bits = 2 + 9ULL * (1 + payloadBytes);
+  uint64_t us = (bits * 1000000ULL + _clock - 1) / _clock;
+
+  _stats.transactions++;
+  _stats.bytes += payloadBytes;
+  _stats.busTimeUs += us;
+  SimClock::advanceUs(us);
+}
@@ -0,0 +1,101 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+// ============================================================================
+// WIRE SHIM - Mock I2C master for host simulation builds
+// ============================================================================
+// Transactions are routed to attached SimI2CDevice instances. Each one
+// advances virtual time by its wire time at the configured clock.
+
+#include "Arduino.h"
+#include "sim_i2c_device.h"
+
+#define I2C_BUFFER_LENGTH 128
+#define SIM_I2C_MAX_DEVICES 8
+
+struct SimI2CStats {
+  uint32_t transactions; // Write + read transactions
+  uint32_t nacks;
+  uint32_t timeouts;     // Transactions on a hung bus
+  uint64_t bytes;        // Payload bytes, address bytes excluded
+  uint64_t busTimeUs;    // Wire time spent on the bus
+};
+
+// Sees every transaction once it completed (recorders)
+class SimI2CTap {
+public:
+  virtual ~SimI2CTap() {}
+
+  // startUs: virtual time at START. data: bytes written, or bytes read back
+  // (none on NACK).
+  virtual void onTransaction(uint64_t startUs, uint8_t address, bool read,
+                             const uint8_t *data, size_t len, bool acked) = 0;
+};
+
+// Wiring faults (all off by default)
+struct SimI2CFaults {
+  uint32_t maxClock = 0;  // Faster transfers fail with a data NACK, 0 = any
+  uint32_t glitchPpm = 0; // Random faults per million transactions, every
+                          // other one hangs the bus until end() + begin()
+};
+
+class TwoWire {
+public:
+  TwoWire();
+
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+  bool end();
+  bool setClock(uint32_t frequency);
+  uint32_t getClock() const { return _clock; }
+  void setTimeOut(uint16_t timeOutMillis) { _timeoutMs = timeOutMillis; }
+  uint16_t getTimeOut() const { return _timeoutMs; }
+
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  size_t write(const uint8_t *data, size_t len);
+  // 0 = success, 1 = data too long, 2 = NACK on address, 3 = NACK on data,
+  // 5 = timeout
+  uint8_t endTransmission(bool sendStop = true);
+
+  uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true);
+  int available();
+  int read();
+
+  // Simulation hooks
+  void attach(SimI2CDevice *device);
+  void detachAll();
+  const SimI2CStats &stats() const { return _stats; }
+  void resetStats();
+  void setTap(SimI2CTap *tap) { _tap = tap; }
+  void setFaults(const SimI2CFaults &faults) { _faults = faults; }
+
+private:
+  SimI2CDevice *_devices[SIM_I2C_MAX_DEVICES];
+  uint8_t _deviceCount;
+  uint32_t _clock;
+  uint16_t _timeoutMs;
+
+  uint8_t _txAddress;
+  uint8_t _txBuffer[I2C_BUFFER_LENGTH];
+  size_t _txLength;
+  bool _txOverflow;
+
+  uint8_t _rxBuffer[I2C_BUFFER_LENGTH];
+  size_t _rxLength;
+  size_t _rxIndex;
+
+  SimI2CStats _stats;
+  SimI2CTap *_tap;
+  SimI2CFaults _faults;
+  uint32_t _faultSeed;
+  uint32_t _glitches;
+  bool _hung; // SDA held low: every transaction times out
+
+  SimI2CDevice *_find(uint8_t address);
+  void _account(size_t payloadBytes);
+  uint8_t _fault();
+};
+
+extern TwoWire Wire;
+
+#endif // WIRE_H
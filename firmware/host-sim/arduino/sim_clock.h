@@ -0,0 +1,27 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <stdint.h>
+
+// ============================================================================
+// SIM CLOCK - Virtual time source for host builds
+// ============================================================================
+// millis()/micros() read this clock, delay() advances it instantly.
+
+class SimClock {
+public:
+  // Current virtual time since "boot"
+  static uint64_t nowUs();
+
+  // Advance virtual time
+  static void advanceUs(uint64_t us);
+  static void advanceMs(uint64_t ms) { advanceUs(ms * 1000ULL); }
+
+  // Back to t = 0 (between independent simulation runs)
+  static void reset();
+
+private:
+  static uint64_t _nowUs;
+};
+
+#endif // SIM_CLOCK_H
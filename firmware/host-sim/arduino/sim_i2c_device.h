@@ -0,0 +1,25 @@
+#ifndef SIM_I2C_DEVICE_H
+#define SIM_I2C_DEVICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// SIM I2C DEVICE - Target side of the mock Wire bus
+// ============================================================================
+
+class SimI2CDevice {
+public:
+  virtual ~SimI2CDevice() {}
+
+  // 7-bit bus address
+  virtual uint8_t address() const = 0;
+
+  // Master wrote len bytes in one transaction. Return false to NACK.
+  virtual bool onWrite(const uint8_t *data, size_t len) = 0;
+
+  // Master reads len bytes. Returns the number of bytes provided.
+  virtual size_t onRead(uint8_t *data, size_t len) = 0;
+};
+
+#endif // SIM_I2C_DEVICE_H
@@ -0,0 +1,91 @@
+/**
+ * TyMos Clock - Host Microbenchmarks
+ *
+ * Times the kernels from utils_bench.cpp (servo pulse math, segment map
+ * lookups, collision checks, transition planning, log formatting) with the
+ * wall clock. Each kernel is scaled until one run takes --min-ms, then the
+ * best of --repeat runs is reported, so a busy machine only costs accuracy
+ * in the outliers. Run it before and after a change on the same machine.
+ *
+ * Usage: tymos_bench [--filter SUBSTRING] [--min-ms N] [--repeat N]
+ */
+
+#include <Arduino.h>
+#include <chrono>
+#include <stdint.h>
+
+#include "config.h"
+#include "core_settings_manager.h"
+#include "motion_calibration.h"
+#include "utils_bench.h"
+#include "utils_logger.h"
+
+struct BenchOptions {
+  const char *filter = NULL;
+  double minMs = 50.0;
+  int repeat = 5;
+};
+
+static bool parseArgs(int argc, char **argv, BenchOptions &opt) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    bool hasValue = (i + 1 < argc);
+
+    if (!strcmp(arg, "--filter") && hasValue) {
+      opt.filter = argv[++i];
+    } else if (!strcmp(arg, "--min-ms") && hasValue) {
+      opt.minMs = atof(argv[++i]);
+    } else if (!strcmp(arg, "--repeat") && hasValue) {
+      opt.repeat = atoi(argv[++i]);
+    } else {
+      return false;
+    }
+  }
+  return opt.minMs > 0 && opt.repeat > 0;
+}
+
+static volatile uint32_t sink;
+
+static double runMs(const BenchKernel &kernel, uint32_t iterations) {
+  auto start = std::chrono::steady_clock::now();
+  sink += kernel.run(iterations);
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char **argv) {
+  BenchOptions opt;
+  if (!parseArgs(argc, argv, opt)) {
+    fprintf(stderr, "Usage: %s [--filter SUBSTRING] [--min-ms N] "
+                    "[--repeat N]\n",
+            argv[0]);
+    return 1;
+  }
+
+  // Same state the kernels see on the clock (defaults, nothing stored)
+  Logger.begin();
+  Calibration.begin();
+  Settings.begin();
+
+  printf("%-24s %12s %12s\n", "kernel", "ns/op", "iterations");
+  for (uint8_t k = 0; k < BENCH_KERNEL_COUNT; k++) {
+    const BenchKernel &kernel = BENCH_KERNELS[k];
+    if (opt.filter && !strstr(kernel.name, opt.filter))
+      continue;
+
+    // Grow the run until it is long enough to time
+    uint32_t iterations = 1;
+    while (iterations < (1u << 30) && runMs(kernel, iterations) < opt.minMs)
+      iterations *= 2;
+
+    double best = 0;
+    for (int r = 0; r < opt.repeat; r++) {
+      double ms = runMs(kernel, iterations);
+      if (r == 0 || ms < best)
+        best = ms;
+    }
+    printf("%-24s %12.1f %12lu\n", kernel.name, best * 1e6 / iterations,
+           (unsigned long)iterations);
+  }
+  return 0;
+}
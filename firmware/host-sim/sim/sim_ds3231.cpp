@@ -0,0 +1,74 @@
+#include "sim_ds3231.h"
+#include "sim_clock.h"
+
+static uint8_t bcd2bin(uint8_t val) { return val - 6 * (val >> 4); }
+static uint8_t bin2bcd(uint8_t val) { return val + 6 * (val / 10); }
+
+SimDS3231::SimDS3231() {
+  memset(_regs, 0, sizeof(_regs));
+  _pointer = 0;
+  _readCount = 0;
+  _regs[DS3231_TEMPERATUREREG] = 25; // 25.00 C
+  setTime(DateTime(2025, 1, 1, 12, 0, 0));
+}
+
+void SimDS3231::setTime(const DateTime &dt) {
+  _offsetUs = (int64_t)dt.unixtime() * 1000000LL - (int64_t)SimClock::nowUs();
+}
+
+DateTime SimDS3231::time() const {
+  int64_t us = (int64_t)SimClock::nowUs() + _offsetUs;
+  return DateTime((uint32_t)(us / 1000000LL));
+}
+
+void SimDS3231::setLostPower(bool lost) {
+  if (lost)
+    _regs[DS3231_STATUSREG] |= 0x80;
+  else
+    _regs[DS3231_STATUSREG] &= ~0x80;
+}
+
+bool SimDS3231::onWrite(const uint8_t *data, size_t len) {
+  if (len == 0)
+    return true; // Address probe
+
+  _pointer = data[0];
+  bool timeWritten = false;
+  _loadTimeRegisters();
+  for (size_t i = 1; i < len; i++) {
+    if (_pointer < sizeof(_regs)) {
+      _regs[_pointer] = data[i];
+      if (_pointer <= 0x06)
+        timeWritten = true;
+    }
+    _pointer++;
+  }
+
+  if (timeWritten) {
+    setTime(DateTime(bcd2bin(_regs[6]) + 2000U, bcd2bin(_regs[5] & 0x7F),
+                     bcd2bin(_regs[4]), bcd2bin(_regs[2]), bcd2bin(_regs[1]),
+                     bcd2bin(_regs[0] & 0x7F)));
+  }
+  return true;
+}
+
+size_t SimDS3231::onRead(uint8_t *data, size_t len) {
+  _readCount++;
+  _loadTimeRegisters();
+  for (size_t i = 0; i < len; i++) {
+    data[i] = (_pointer < sizeof(_regs)) ? _regs[_pointer] : 0;
+    _pointer++;
+  }
+  return len;
+}
+
+void SimDS3231::_loadTimeRegisters() {
+  DateTime now = time();
+  _regs[0] = bin2bcd(now.second());
+  _regs[1] = bin2bcd(now.minute());
+  _regs[2] = bin2bcd(now.hour());
+  _regs[3] = bin2bcd(now.dayOfTheWeek() ? now.dayOfTheWeek() : 7);
+  _regs[4] = bin2bcd(now.day());
+  _regs[5] = bin2bcd(now.month());
+  _regs[6] = bin2bcd(now.year() - 2000U);
+}
@@ -0,0 +1,35 @@
+#ifndef SIM_DS3231_H
+#define SIM_DS3231_H
+
+#include "RTClib.h"
+#include "sim_i2c_device.h"
+
+// ============================================================================
+// SIM DS3231 - Fake RTC counting seconds on the virtual clock
+// ============================================================================
+
+class SimDS3231 : public SimI2CDevice {
+public:
+  SimDS3231();
+
+  uint8_t address() const override { return DS3231_ADDRESS; }
+  bool onWrite(const uint8_t *data, size_t len) override;
+  size_t onRead(uint8_t *data, size_t len) override;
+
+  // Set the wall clock (the seconds counter restarts, as on the chip)
+  void setTime(const DateTime &dt);
+  DateTime time() const;
+
+  void setLostPower(bool lost);
+  uint32_t readCount() const { return _readCount; }
+
+private:
+  uint8_t _regs[0x13];
+  uint8_t _pointer;
+  int64_t _offsetUs; // Wall clock (unix, us) minus virtual time
+  uint32_t _readCount;
+
+  void _loadTimeRegisters();
+};
+
+#endif // SIM_DS3231_H
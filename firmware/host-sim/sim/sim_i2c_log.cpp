@@ -0,0 +1,125 @@
+#include "sim_i2c_log.h"
+#include <string.h>
+
+#define FLAG_READ 0x01
+#define FLAG_NACK 0x02
+
+SimI2CLogWriter::SimI2CLogWriter() {
+  _file = NULL;
+  _lastUs = 0;
+  _records = 0;
+  _failed = false;
+}
+
+SimI2CLogWriter::~SimI2CLogWriter() { close(); }
+
+bool SimI2CLogWriter::open(const char *path) {
+  close();
+  _file = fopen(path, "wb");
+  if (!_file)
+    return false;
+  _lastUs = 0;
+  _records = 0;
+  _failed = fwrite(SIM_I2C_LOG_MAGIC, 1, 8, _file) != 8;
+  return !_failed;
+}
+
+bool SimI2CLogWriter::close() {
+  if (!_file)
+    return !_failed;
+  if (fclose(_file) != 0)
+    _failed = true;
+  _file = NULL;
+  return !_failed;
+}
+
+void SimI2CLogWriter::onTransaction(uint64_t startUs, uint8_t address,
+                                    bool read, const uint8_t *data,
+                                    size_t len, bool acked) {
+  if (!_file)
+    return;
+
+  uint8_t head[3 + 10];
+  size_t n = 0;
+  head[n++] = (read ? FLAG_READ : 0) | (acked ? 0 : FLAG_NACK);
+  head[n++] = address;
+  head[n++] = (uint8_t)len;
+  uint64_t delta = startUs - _lastUs;
+  do {
+    uint8_t b = delta & 0x7F;
+    delta >>= 7;
+    head[n++] = b | (delta ? 0x80 : 0);
+  } while (delta);
+  _lastUs = startUs;
+
+  if (fwrite(head, 1, n, _file) != n ||
+      (len && fwrite(data, 1, len, _file) != len))
+    _failed = true;
+  _records++;
+}
+
+SimI2CLogReader::SimI2CLogReader() {
+  _file = NULL;
+  _lastUs = 0;
+  _truncated = false;
+}
+
+SimI2CLogReader::~SimI2CLogReader() { close(); }
+
+bool SimI2CLogReader::open(const char *path) {
+  close();
+  _file = fopen(path, "rb");
+  if (!_file)
+    return false;
+  char magic[8];
+  if (fread(magic, 1, 8, _file) != 8 ||
+      memcmp(magic, SIM_I2C_LOG_MAGIC, 8) != 0) {
+    close();
+    return false;
+  }
+  _lastUs = 0;
+  _truncated = false;
+  return true;
+}
+
+void SimI2CLogReader::close() {
+  if (_file)
+    fclose(_file);
+  _file = NULL;
+}
+
+bool SimI2CLogReader::next(SimI2CLogRecord &record) {
+  if (!_file)
+    return false;
+
+  uint8_t head[3];
+  size_t got = fread(head, 1, 3, _file);
+  if (got != 3) {
+    _truncated = got != 0;
+    return false;
+  }
+  uint64_t delta = 0;
+  for (int shift = 0;; shift += 7) {
+    int c = fgetc(_file);
+    if (c == EOF || shift > 63) {
+      _truncated = true;
+      return false;
+    }
+    delta |= (uint64_t)(c & 0x7F) << shift;
+    if (!(c & 0x80))
+      break;
+  }
+  if (head[2] > I2C_BUFFER_LENGTH ||
+      fread(record.data, 1, head[2], _file) != head[2]) {
+    _truncated = true;
+    return false;
+  }
+
+  _lastUs += delta;
+  record.timeUs = _lastUs;
+  record.read = head[0] & FLAG_READ;
+  record.acked = !(head[0] & FLAG_NACK);
+  record.address = head[1];
+  record.length = head[2];
+  return true;
+}
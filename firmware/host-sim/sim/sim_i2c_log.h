@@ -0,0 +1,71 @@
+#ifndef SIM_I2C_LOG_H
+#define SIM_I2C_LOG_H
+
+#include <Wire.h>
+#include <stdio.h>
+
+// ============================================================================
+// SIM I2C LOG - Binary record of every bus transaction
+// ============================================================================
+// File layout: the 8-byte magic "TYI2CLG1", then one record per
+// transaction:
+//   flags   1 byte  bit 0 = read, bit 1 = NACK
+//   address 1 byte  7-bit address
+//   length  1 byte  payload bytes (write: register + data, read: data)
+//   delta   varint  virtual us since the previous record's START (LEB128)
+//   payload length bytes
+// A servo frame (register + 4 bytes) takes about 9 bytes.
+
+#define SIM_I2C_LOG_MAGIC "TYI2CLG1"
+
+struct SimI2CLogRecord {
+  uint64_t timeUs; // Virtual time at START
+  uint8_t address;
+  bool read;
+  bool acked;
+  uint8_t length;
+  uint8_t data[I2C_BUFFER_LENGTH];
+};
+
+// Attach with Wire.setTap()
+class SimI2CLogWriter : public SimI2CTap {
+public:
+  SimI2CLogWriter();
+  ~SimI2CLogWriter();
+
+  bool open(const char *path);
+  // False if a write failed since open()
+  bool close();
+  uint32_t records() const { return _records; }
+
+  void onTransaction(uint64_t startUs, uint8_t address, bool read,
+                     const uint8_t *data, size_t len, bool acked) override;
+
+private:
+  FILE *_file;
+  uint64_t _lastUs;
+  uint32_t _records;
+  bool _failed;
+};
+
+class SimI2CLogReader {
+public:
+  SimI2CLogReader();
+  ~SimI2CLogReader();
+
+  // False if the file is missing or not a log
+  bool open(const char *path);
+  void close();
+
+  // Next record; false at the end (or on a truncated record, see
+  // truncated())
+  bool next(SimI2CLogRecord &record);
+  bool truncated() const { return _truncated; }
+
+private:
+  FILE *_file;
+  uint64_t _lastUs;
+  bool _truncated;
+};
+
+#endif // SIM_I2C_LOG_H
@@ -0,0 +1,98 @@
+#include "sim_pca9685.h"
+#include "Adafruit_PWMServoDriver.h"
+#include "sim_clock.h"
+
+SimPCA9685::SimPCA9685(uint8_t address) {
+  _address = address;
+  _pointer = 0;
+  _recording = true;
+  memset(_regs, 0, sizeof(_regs));
+  memset(_lastWidth, 0, sizeof(_lastWidth));
+  memset(_travel, 0, sizeof(_travel));
+  _peakHigh = 0;
+
+  // Power-on defaults
+  _regs[PCA9685_MODE1] = MODE1_SLEEP | MODE1_ALLCAL;
+  _regs[PCA9685_MODE2] = 0x04;
+  _regs[PCA9685_PRESCALE] = 0x1E;
+}
+
+bool SimPCA9685::onWrite(const uint8_t *data, size_t len) {
+  if (len == 0)
+    return true; // Address probe
+
+  _pointer = data[0];
+  for (size_t i = 1; i < len; i++) {
+    _writeRegister(_pointer, data[i]);
+    if (_regs[PCA9685_MODE1] & MODE1_AI)
+      _pointer++;
+  }
+  _accountOutputs();
+  return true;
+}
+
+size_t SimPCA9685::onRead(uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    data[i] = _regs[_pointer];
+    if (_regs[PCA9685_MODE1] & MODE1_AI)
+      _pointer++;
+  }
+  return len;
+}
+
+uint16_t SimPCA9685::channelOn(uint8_t channel) const {
+  uint8_t base = PCA9685_LED0_ON_L + 4 * channel;
+  return _regs[base] | ((_regs[base + 1] & 0x1F) << 8);
+}
+
+uint16_t SimPCA9685::channelOff(uint8_t channel) const {
+  uint8_t base = PCA9685_LED0_ON_L + 4 * channel + 2;
+  return _regs[base] | ((_regs[base + 1] & 0x1F) << 8);
+}
+
+void SimPCA9685::resetOutputStats() {
+  memset(_travel, 0, sizeof(_travel));
+  _peakHigh = 0;
+}
+
+void SimPCA9685::_accountOutputs() {
+  uint16_t on[16];
+  uint16_t width[16]; // 0 = output low
+  for (uint8_t c = 0; c < 16; c++) {
+    uint16_t off = channelOff(c);
+    on[c] = channelOn(c) & 0x0FFF;
+    width[c] = 0;
+    if (off == 0 || (off & 0x1000))
+      continue; // Never driven, or full off
+    width[c] = (off - on[c]) & 0x0FFF;
+    if (_lastWidth[c])
+      _travel[c] += width[c] > _lastWidth[c] ? width[c] - _lastWidth[c]
+                                             : _lastWidth[c] - width[c];
+    _lastWidth[c] = width[c];
+  }
+
+  // The most outputs overlap at the rising edge of one of them
+  for (uint8_t i = 0; i < 16; i++) {
+    if (!width[i])
+      continue;
+    uint8_t high = 0;
+    for (uint8_t j = 0; j < 16; j++) {
+      if (width[j] && ((on[i] - on[j]) & 0x0FFF) < width[j])
+        high++;
+    }
+    if (high > _peakHigh)
+      _peakHigh = high;
+  }
+}
+
+void SimPCA9685::_writeRegister(uint8_t reg, uint8_t value) {
+  // RESTART is self-clearing
+  if (reg == PCA9685_MODE1)
+    value &= ~MODE1_RESTART;
+
+  _regs[reg] = value;
+  if (_recording) {
+    SimRegisterWrite w = {SimClock::nowUs(), _address, reg, value};
+    _writes.push_back(w);
+  }
+}
@@ -0,0 +1,61 @@
+#ifndef SIM_PCA9685_H
+#define SIM_PCA9685_H
+
+#include "sim_i2c_device.h"
+#include <vector>
+
+// ============================================================================
+// SIM PCA9685 - Fake PWM controller recording every register write
+// ============================================================================
+
+struct SimRegisterWrite {
+  uint64_t timeUs; // Virtual time of the transaction
+  uint8_t address;
+  uint8_t reg;
+  uint8_t value;
+};
+
+class SimPCA9685 : public SimI2CDevice {
+public:
+  SimPCA9685(uint8_t address);
+
+  uint8_t address() const override { return _address; }
+  bool onWrite(const uint8_t *data, size_t len) override;
+  size_t onRead(uint8_t *data, size_t len) override;
+
+  // Register state
+  uint8_t reg(uint8_t reg) const { return _regs[reg]; }
+  uint16_t channelOn(uint8_t channel) const;
+  uint16_t channelOff(uint8_t channel) const;
+
+  // Write log (enabled by default)
+  void setRecording(bool enabled) { _recording = enabled; }
+  const std::vector<SimRegisterWrite> &writes() const { return _writes; }
+  void clearWrites() { _writes.clear(); }
+
+  // Output statistics since the last resetOutputStats(), sampled after
+  // every transaction (a burst that rewrites a channel is one step).
+  // Travel: sum of |pulse width changes| (counts) per channel, skipping
+  // full-off (a detached servo stays where it was).
+  uint64_t travelCounts(uint8_t channel) const { return _travel[channel]; }
+  // Most outputs high at the same count of the PWM period: the servos
+  // drawing their pulse current together
+  uint8_t peakHighChannels() const { return _peakHigh; }
+  void resetOutputStats();
+
+private:
+  uint8_t _address;
+  uint8_t _regs[256];
+  uint8_t _pointer;
+  bool _recording;
+  std::vector<SimRegisterWrite> _writes;
+  uint16_t _lastWidth[16]; // Last real pulse per channel, 0 = none yet
+  uint64_t _travel[16];
+  uint8_t _peakHigh;
+
+  void _accountOutputs();
+
+  void _writeRegister(uint8_t reg, uint8_t value);
+};
+
+#endif // SIM_PCA9685_H
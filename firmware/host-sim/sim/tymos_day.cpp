@@ -0,0 +1,251 @@
+/**
+ * TyMos Clock - Full-Day Replay
+ *
+ * Runs the firmware through all 1440 minute changes of a day, once per
+ * speed profile, in virtual time against the simulated PCA9685 boards and
+ * DS3231. The clock warm-boots at 23:59 showing the right time, so every
+ * change goes through CoreDisplayManager::update() -> showTime() the way
+ * it does on the wall. Each day reports servo travel, bus load, flip
+ * latency and the longest loop() stall as key=value lines, prefixed by the
+ * speed; tools/day_compare.py diffs two reports.
+ *
+ * Usage: tymos_day [--speed fast|normal|night]
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <chrono>
+#include <stdint.h>
+
+#include "config.h"
+#include "core_display_manager.h"
+#include "core_settings_manager.h"
+#include "hw_i2c_bus.h"
+#include "hw_pca9685.h"
+#include "hw_rtc.h"
+#include "motion_calibration.h"
+#include "motion_collision.h"
+#include "motion_engine.h"
+#include "motion_pose_store.h"
+#include "motion_scheduler.h"
+#include "motion_servo.h"
+#include "motion_task.h"
+#include "sim_clock.h"
+#include "sim_ds3231.h"
+#include "sim_pca9685.h"
+#include "utils_logger.h"
+#include "utils_profiler.h"
+
+// Same object graph as TyMos_Phase0.ino
+HwPCA9685 pwmDriver;
+RTCDriver rtcDriver;
+MotionServo motionServo(&pwmDriver);
+MotionScheduler motionScheduler(&motionServo);
+MotionCollision motionCollision(&motionScheduler);
+MotionEngine motionEngine(&motionServo, &motionCollision, &motionScheduler);
+MotionTask motionTask(&motionEngine);
+CoreDisplayManager displayManager(&rtcDriver, &motionTask);
+
+// Simulated devices
+SimPCA9685 simHours(PCA9685_ADDR_HOURS);
+SimPCA9685 simMinutes(PCA9685_ADDR_MINUTES);
+SimDS3231 simRtc;
+
+#define DAY_TRANSITIONS 1440
+// Give up on a day that has not finished its transitions by then
+#define DAY_LIMIT_US ((DAY_TRANSITIONS + 10) * 60000000ULL)
+
+static const SpeedProfile SPEEDS[] = {SPEED_FAST, SPEED_NORMAL, SPEED_NIGHT};
+static const char *SPEED_NAMES[] = {"fast", "normal", "night"};
+
+struct DayStats {
+  uint32_t transitions = 0;
+  int64_t totalSettleUs = 0;
+  int64_t maxSettleUs = INT64_MIN;
+  uint32_t late = 0; // Settled after the minute boundary
+  uint64_t totalDurationUs = 0;
+  uint64_t maxDurationUs = 0;
+  uint64_t maxLoopUs = 0;
+};
+
+static double travelDegrees() {
+  // Pulse counts back to degrees with the nominal servo range
+  uint64_t counts = 0;
+  for (uint8_t c = 0; c < 16; c++)
+    counts += simHours.travelCounts(c) + simMinutes.travelCounts(c);
+  double usPerCount = 20000.0 / 4096.0;
+  return counts * usPerCount * 180.0 /
+         (SERVO_MAX_PULSE_US - SERVO_MIN_PULSE_US);
+}
+
+// The boards are not synchronized: their peaks can coincide
+static uint32_t peakHigh() {
+  return simHours.peakHighChannels() + simMinutes.peakHighChannels();
+}
+
+// The RTC starts at 23:59:00, minute boundary 0
+#define RTC_START_MINUTE (23 * 60 + 59)
+
+// Boundary (minutes since the RTC epoch) at which minuteOfDay is due, the
+// occurrence nearest to sinceRtcUs
+static int64_t dueBoundary(int minuteOfDay, uint64_t sinceRtcUs) {
+  int64_t now = (int64_t)(sinceRtcUs / 60000000ULL);
+  int64_t ahead =
+      ((minuteOfDay - RTC_START_MINUTE - now) % 1440 + 1440) % 1440;
+  return ahead > 720 ? now + ahead - 1440 : now + ahead;
+}
+
+// loop() until DAY_TRANSITIONS minute changes have settled
+static bool runDay(uint64_t rtcEpochUs, DayStats &day) {
+  uint64_t limitUs = SimClock::nowUs() + DAY_LIMIT_US;
+  bool busy = motionTask.isBusy();
+  uint64_t busySinceUs = SimClock::nowUs();
+  int64_t dueMinute = 0;
+
+  while (day.transitions < DAY_TRANSITIONS) {
+    if (SimClock::nowUs() >= limitUs)
+      return false;
+
+    uint64_t start = SimClock::nowUs();
+    rtcDriver.update();
+    Settings.update();
+    motionTask.step();
+    displayManager.update();
+    // The fixed delay is not part of the stall
+    uint64_t elapsed = SimClock::nowUs() - start;
+    if (elapsed > day.maxLoopUs)
+      day.maxLoopUs = elapsed;
+    delay(1);
+
+    bool nowBusy = motionTask.isBusy();
+    if (nowBusy && !busy) {
+      // Posted this iteration: the display manager already shows the
+      // minute the change was armed for
+      busySinceUs = start;
+      dueMinute = dueBoundary(displayManager.displayedMinute(),
+                              start - rtcEpochUs);
+    }
+    if (busy && !nowBusy) {
+      // Against the boundary the change was armed for, negative = early
+      uint64_t settledUs = SimClock::nowUs();
+      int64_t settleUs = (int64_t)(settledUs - rtcEpochUs) -
+                         dueMinute * (int64_t)60000000;
+      uint64_t durationUs = settledUs - busySinceUs;
+
+      day.transitions++;
+      day.totalSettleUs += settleUs;
+      if (settleUs > day.maxSettleUs)
+        day.maxSettleUs = settleUs;
+      if (settleUs > 0)
+        day.late++;
+      day.totalDurationUs += durationUs;
+      if (durationUs > day.maxDurationUs)
+        day.maxDurationUs = durationUs;
+    }
+    busy = nowBusy;
+  }
+  return true;
+}
+
+static void printDay(const char *name, const DayStats &day) {
+  const SimI2CStats &bus = Wire.stats();
+  uint32_t n = day.transitions ? day.transitions : 1;
+
+  printf("%s_transitions=%u\n", name, day.transitions);
+  printf("%s_servo_travel_deg=%.0f\n", name, travelDegrees());
+  printf("%s_pwm_peak_high=%u\n", name, peakHigh());
+  printf("%s_i2c_transactions=%u\n", name, bus.transactions);
+  printf("%s_i2c_bytes=%llu\n", name, (unsigned long long)bus.bytes);
+  printf("%s_i2c_busy_ms=%.1f\n", name, bus.busTimeUs / 1000.0);
+  printf("%s_i2c_nacks=%u\n", name, bus.nacks);
+  printf("%s_flip_latency_avg_ms=%+.1f\n", name,
+         day.totalSettleUs / 1000.0 / n);
+  printf("%s_flip_latency_max_ms=%+.1f\n", name,
+         day.transitions ? day.maxSettleUs / 1000.0 : 0.0);
+  printf("%s_flip_late=%u\n", name, day.late);
+  printf("%s_flip_duration_avg_ms=%.1f\n", name,
+         day.totalDurationUs / 1000.0 / n);
+  printf("%s_flip_duration_max_ms=%.1f\n", name, day.maxDurationUs / 1000.0);
+  printf("%s_loop_max_us=%llu\n", name, (unsigned long long)day.maxLoopUs);
+}
+
+int main(int argc, char **argv) {
+  int only = -1;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--speed") && i + 1 < argc) {
+      const char *s = argv[++i];
+      for (int k = 0; k < 3; k++) {
+        if (!strcmp(s, SPEED_NAMES[k]))
+          only = k;
+      }
+      if (only < 0)
+        argc = 0; // Usage below
+    } else {
+      argc = 0;
+    }
+  }
+  if (argc == 0) {
+    fprintf(stderr, "Usage: tymos_day [--speed fast|normal|night]\n");
+    return 2;
+  }
+  Serial.setEcho(false); // Keep stdout machine-readable
+
+  Wire.attach(&simHours);
+  Wire.attach(&simMinutes);
+  Wire.attach(&simRtc);
+  // Travel is counted by the boards; the write log would only grow
+  simHours.setRecording(false);
+  simMinutes.setRecording(false);
+  simRtc.setTime(DateTime(2025, 1, 1, 23, 59, 0));
+  uint64_t rtcEpochUs = SimClock::nowUs();
+  auto wallStart = std::chrono::steady_clock::now();
+
+  // setup() without WiFi, warm boot on the displayed 23:59
+  Logger.begin();
+  Profiler.begin();
+  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+  I2CBus.begin();
+  pwmDriver.begin(PCA9685_ADDR_HOURS, PCA9685_ADDR_MINUTES, PCA9685_PWM_FREQ);
+  Calibration.begin();
+  motionServo.loadCalibration();
+  Settings.begin();
+  rtcDriver.begin();
+  DisplayState pose;
+  pose.digits[DIGIT_DO] = 2;
+  pose.digits[DIGIT_UO] = 3;
+  pose.digits[DIGIT_DM] = 5;
+  pose.digits[DIGIT_UM] = 9;
+  pose.separator = true;
+  PoseStore.markSettled(pose);
+  if (!PoseStore.load(pose))
+    motionEngine.homeQuick(pose);
+  Settings.setSpeed(SPEEDS[only < 0 ? 0 : only]);
+  motionTask.begin(pose);
+  displayManager.begin(pose);
+
+  int exitCode = 0;
+  for (int k = 0; k < 3; k++) {
+    if (only >= 0 && k != only)
+      continue;
+    // The next lead re-estimates with the new speed on its first poll
+    Settings.setSpeed(SPEEDS[k]);
+    Wire.resetStats();
+    simHours.resetOutputStats();
+    simMinutes.resetOutputStats();
+
+    DayStats day;
+    if (!runDay(rtcEpochUs, day)) {
+      fprintf(stderr, "%s: only %u of %u transitions\n", SPEED_NAMES[k],
+              day.transitions, DAY_TRANSITIONS);
+      exitCode = 1;
+    }
+    printDay(SPEED_NAMES[k], day);
+  }
+
+  double wallMs = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - wallStart)
+                      .count();
+  printf("sim_time_s=%.3f\n", SimClock::nowUs() / 1e6);
+  printf("wall_time_ms=%.1f\n", wallMs);
+  return exitCode;
+}
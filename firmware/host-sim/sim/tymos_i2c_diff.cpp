@@ -0,0 +1,306 @@
+/**
+ * TyMos Clock - I2C Log Replay and Diff
+ *
+ * Replays two logs written by `tymos_sim --i2c-log` into fresh simulated
+ * PCA9685 boards and compares them transition by transition. A transition
+ * is a burst of PWM writes separated from the next one by at least
+ * --gap-ms of bus silence (the boot sequence is the first one).
+ *
+ * For each transition the servo outputs are reduced to state changes: a
+ * channel's pulse width (ON offset ignored) or full-off, and the value of
+ * any other register. Rewriting a value the board already holds is not a
+ * change, so bursts, skipped writes and different framings compare equal
+ * as long as every output goes through the same states and ends in the
+ * same place. Reported per transition:
+ *   - final state of every channel (must match)
+ *   - extra / missing state changes, and matched ones out of order
+ *   - PWM transactions and bytes, start and end time deltas
+ *
+ * Usage: tymos_i2c_diff baseline.i2c candidate.i2c [--gap-ms N] [--all]
+ *                       [--strict]
+ * Exit status: 0 equivalent, 1 different (final states or transition
+ * count; with --strict any change sequence difference), 2 bad input.
+ */
+
+#include <algorithm>
+#include <map>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "config.h"
+#include "sim_i2c_log.h"
+#include "sim_pca9685.h"
+
+#define BOARD_COUNT 2
+static const uint8_t BOARD_ADDRS[BOARD_COUNT] = {PCA9685_ADDR_HOURS,
+                                                 PCA9685_ADDR_MINUTES};
+#define LED_FIRST_REG 0x06 // LED0_ON_L
+#define LED_LAST_REG 0x45  // LED15_OFF_H
+
+// Output state of a channel: pulse width in counts, or one of these
+#define STATE_FULL_OFF 0x10000
+#define STATE_FULL_ON 0x20000
+
+struct StateChange {
+  uint8_t board;
+  uint16_t key; // Channel 0-15, or 0x100 + register
+  uint32_t value;
+
+  bool operator<(const StateChange &o) const {
+    if (board != o.board)
+      return board < o.board;
+    if (key != o.key)
+      return key < o.key;
+    return value < o.value;
+  }
+};
+
+struct Transition {
+  uint64_t startUs = 0;
+  uint64_t endUs = 0; // START of the last PWM write
+  uint32_t transactions = 0;
+  uint64_t bytes = 0;
+  std::vector<StateChange> changes;
+  uint32_t finalState[BOARD_COUNT][16];
+};
+
+struct Replay {
+  std::vector<Transition> transitions;
+  uint32_t transactions = 0; // Whole log, every device
+  uint64_t bytes = 0;
+};
+
+static uint32_t channelState(const SimPCA9685 &board, uint8_t channel) {
+  uint16_t on = board.channelOn(channel);
+  uint16_t off = board.channelOff(channel);
+  if (off & 0x1000)
+    return STATE_FULL_OFF;
+  if (on & 0x1000)
+    return STATE_FULL_ON;
+  return (off - on) & 0x0FFF;
+}
+
+static bool replay(const char *path, uint64_t gapUs, Replay &out) {
+  SimI2CLogReader reader;
+  if (!reader.open(path)) {
+    fprintf(stderr, "%s: not an I2C log\n", path);
+    return false;
+  }
+
+  SimPCA9685 hours(BOARD_ADDRS[0]);
+  SimPCA9685 minutes(BOARD_ADDRS[1]);
+  SimPCA9685 *boards[BOARD_COUNT] = {&hours, &minutes};
+  for (SimPCA9685 *b : boards)
+    b->setRecording(false);
+
+  Transition *current = NULL;
+  SimI2CLogRecord r;
+  while (reader.next(r)) {
+    out.transactions++;
+    out.bytes += r.length;
+
+    int b = 0;
+    while (b < BOARD_COUNT && BOARD_ADDRS[b] != r.address)
+      b++;
+    if (b == BOARD_COUNT || r.read || !r.acked || r.length == 0)
+      continue;
+
+    if (!current || r.timeUs - current->endUs >= gapUs) {
+      out.transitions.emplace_back();
+      current = &out.transitions.back();
+      current->startUs = r.timeUs;
+    }
+    current->endUs = r.timeUs;
+    current->transactions++;
+    current->bytes += r.length;
+
+    SimPCA9685 &board = *boards[b];
+    uint8_t before[256];
+    uint32_t beforeState[16];
+    for (int reg = 0; reg < 256; reg++)
+      before[reg] = board.reg(reg);
+    for (uint8_t c = 0; c < 16; c++)
+      beforeState[c] = channelState(board, c);
+
+    board.onWrite(r.data, r.length);
+
+    for (uint8_t c = 0; c < 16; c++) {
+      uint32_t state = channelState(board, c);
+      if (state != beforeState[c])
+        current->changes.push_back({(uint8_t)b, c, state});
+    }
+    for (int reg = 0; reg < 256; reg++) {
+      if (reg >= LED_FIRST_REG && reg <= LED_LAST_REG)
+        continue;
+      if (board.reg(reg) != before[reg])
+        current->changes.push_back(
+            {(uint8_t)b, (uint16_t)(0x100 + reg), board.reg(reg)});
+    }
+    for (int i = 0; i < BOARD_COUNT; i++) {
+      for (uint8_t c = 0; c < 16; c++)
+        current->finalState[i][c] = channelState(*boards[i], c);
+    }
+  }
+  if (reader.truncated())
+    fprintf(stderr, "%s: truncated, replayed up to the last whole record\n",
+            path);
+  return true;
+}
+
+struct ChangeDiff {
+  uint32_t extra = 0;
+  uint32_t missing = 0;
+  uint32_t reordered = 0;
+};
+
+// Changes are matched by value and occurrence (the 2nd time channel 3 goes
+// to 307 counts matches the 2nd time in the other log). Out of order =
+// matched changes outside the longest run that kept its relative order.
+static ChangeDiff diffChanges(const std::vector<StateChange> &a,
+                              const std::vector<StateChange> &b) {
+  std::map<StateChange, std::vector<uint32_t>> positions;
+  for (uint32_t i = 0; i < a.size(); i++)
+    positions[a[i]].push_back(i);
+  std::map<StateChange, uint32_t> used;
+
+  ChangeDiff d;
+  std::vector<uint32_t> order; // Positions in a, in b's order
+  for (const StateChange &c : b) {
+    auto it = positions.find(c);
+    uint32_t &n = used[c];
+    if (it == positions.end() || n >= it->second.size()) {
+      d.extra++;
+      continue;
+    }
+    order.push_back(it->second[n++]);
+  }
+  d.missing = a.size() - order.size();
+
+  std::vector<uint32_t> tails; // Longest increasing subsequence
+  for (uint32_t p : order) {
+    auto it = std::lower_bound(tails.begin(), tails.end(), p);
+    if (it == tails.end())
+      tails.push_back(p);
+    else
+      *it = p;
+  }
+  d.reordered = order.size() - tails.size();
+  return d;
+}
+
+static double deltaMs(uint64_t a, uint64_t b) {
+  return ((double)b - (double)a) / 1000.0;
+}
+
+int main(int argc, char **argv) {
+  const char *paths[2] = {NULL, NULL};
+  int gapMs = 5000; // Longer than the segment 7 hold
+  bool all = false;
+  bool strict = false;
+  int files = 0;
+  bool ok = true;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--gap-ms") && i + 1 < argc)
+      gapMs = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--all"))
+      all = true;
+    else if (!strcmp(argv[i], "--strict"))
+      strict = true;
+    else if (argv[i][0] != '-' && files < 2)
+      paths[files++] = argv[i];
+    else
+      ok = false;
+  }
+  if (!ok || files != 2 || gapMs <= 0) {
+    fprintf(stderr,
+            "Usage: %s baseline.i2c candidate.i2c [--gap-ms N] [--all] "
+            "[--strict]\n",
+            argv[0]);
+    return 2;
+  }
+
+  Replay old, cur;
+  if (!replay(paths[0], gapMs * 1000ULL, old) ||
+      !replay(paths[1], gapMs * 1000ULL, cur))
+    return 2;
+
+  size_t n = std::min(old.transitions.size(), cur.transitions.size());
+  uint32_t stateMismatches = 0;
+  ChangeDiff total;
+  double maxEndDeltaMs = 0;
+  for (size_t t = 0; t < n; t++) {
+    const Transition &a = old.transitions[t];
+    const Transition &b = cur.transitions[t];
+    ChangeDiff d = diffChanges(a.changes, b.changes);
+    uint32_t channels = 0;
+    for (int i = 0; i < BOARD_COUNT; i++) {
+      for (int c = 0; c < 16; c++)
+        channels += a.finalState[i][c] != b.finalState[i][c];
+    }
+    double startMs = deltaMs(a.startUs, b.startUs);
+    double endMs = deltaMs(a.endUs, b.endUs);
+    if (endMs > maxEndDeltaMs || -endMs > maxEndDeltaMs)
+      maxEndDeltaMs = endMs < 0 ? -endMs : endMs;
+
+    stateMismatches += channels != 0;
+    total.extra += d.extra;
+    total.missing += d.missing;
+    total.reordered += d.reordered;
+
+    bool differs = channels || d.extra || d.missing || d.reordered;
+    if (all || differs) {
+      printf("transition=%zu at_s=%.3f txn=%u->%u bytes=%llu->%llu "
+             "start_delta_ms=%+.1f end_delta_ms=%+.1f extra=%u missing=%u "
+             "reordered=%u final=%s\n",
+             t, a.startUs / 1e6, a.transactions, b.transactions,
+             (unsigned long long)a.bytes, (unsigned long long)b.bytes,
+             startMs, endMs, d.extra, d.missing, d.reordered,
+             channels ? "MISMATCH" : "ok");
+      if (channels) {
+        for (int i = 0; i < BOARD_COUNT; i++) {
+          for (int c = 0; c < 16; c++) {
+            if (a.finalState[i][c] != b.finalState[i][c])
+              printf("  0x%02X ch%d: 0x%05X -> 0x%05X\n", BOARD_ADDRS[i], c,
+                     a.finalState[i][c], b.finalState[i][c]);
+          }
+        }
+      }
+    }
+  }
+
+  uint64_t oldPwmBytes = 0, curPwmBytes = 0;
+  uint32_t oldPwmTxn = 0, curPwmTxn = 0;
+  for (const Transition &t : old.transitions) {
+    oldPwmTxn += t.transactions;
+    oldPwmBytes += t.bytes;
+  }
+  for (const Transition &t : cur.transitions) {
+    curPwmTxn += t.transactions;
+    curPwmBytes += t.bytes;
+  }
+
+  printf("transitions_baseline=%zu\n", old.transitions.size());
+  printf("transitions_candidate=%zu\n", cur.transitions.size());
+  printf("pwm_transactions_baseline=%u\n", oldPwmTxn);
+  printf("pwm_transactions_candidate=%u\n", curPwmTxn);
+  printf("pwm_bytes_baseline=%llu\n", (unsigned long long)oldPwmBytes);
+  printf("pwm_bytes_candidate=%llu\n", (unsigned long long)curPwmBytes);
+  printf("i2c_transactions_baseline=%u\n", old.transactions);
+  printf("i2c_transactions_candidate=%u\n", cur.transactions);
+  printf("i2c_bytes_baseline=%llu\n", (unsigned long long)old.bytes);
+  printf("i2c_bytes_candidate=%llu\n", (unsigned long long)cur.bytes);
+  printf("final_state_mismatches=%u\n", stateMismatches);
+  printf("changes_extra=%u\n", total.extra);
+  printf("changes_missing=%u\n", total.missing);
+  printf("changes_reordered=%u\n", total.reordered);
+  printf("end_delta_max_ms=%.1f\n", maxEndDeltaMs);
+
+  bool equivalent = stateMismatches == 0 &&
+                    old.transitions.size() == cur.transitions.size();
+  if (strict && (total.extra || total.missing || total.reordered))
+    equivalent = false;
+  printf("equivalent=%s\n", equivalent ? "yes" : "no");
+  return equivalent ? 0 : 1;
+}
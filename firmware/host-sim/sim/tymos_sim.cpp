@@ -0,0 +1,386 @@
+/**
+ * TyMos Clock - Host Simulation
+ *
+ * Runs the Phase 0 motion stack on Linux against the Arduino shim:
+ * virtual time, mock Wire bus, fake PCA9685 boards and a fake DS3231.
+ *
+ * Usage: tymos_sim [--start HH:MM] [--minutes N] [--speed fast|normal|night]
+ *                  [--reset | --warm] [--verbose] [--transitions]
+ *                  [--csv FILE] [--trace FILE] [--i2c-log FILE]
+ *                  [--i2c-max-clock HZ] [--i2c-glitch-ppm N]
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <chrono>
+#include <stdint.h>
+
+#include "config.h"
+#include "core_display_manager.h"
+#include "core_settings_manager.h"
+#include "hw_i2c_bus.h"
+#include "hw_pca9685.h"
+#include "hw_rtc.h"
+#include "motion_calibration.h"
+#include "motion_collision.h"
+#include "motion_engine.h"
+#include "motion_pose_store.h"
+#include "motion_scheduler.h"
+#include "motion_servo.h"
+#include "motion_task.h"
+#include "sim_clock.h"
+#include "sim_ds3231.h"
+#include "sim_i2c_log.h"
+#include "sim_pca9685.h"
+#include "utils_logger.h"
+#include "utils_profiler.h"
+#include "utils_trace.h"
+
+// Same object graph as TyMos_Phase0.ino
+HwPCA9685 pwmDriver;
+RTCDriver rtcDriver;
+MotionServo motionServo(&pwmDriver);
+MotionScheduler motionScheduler(&motionServo);
+MotionCollision motionCollision(&motionScheduler);
+MotionEngine motionEngine(&motionServo, &motionCollision, &motionScheduler);
+MotionTask motionTask(&motionEngine);
+CoreDisplayManager displayManager(&rtcDriver, &motionTask);
+
+// Simulated devices
+SimPCA9685 simHours(PCA9685_ADDR_HOURS);
+SimPCA9685 simMinutes(PCA9685_ADDR_MINUTES);
+SimDS3231 simRtc;
+
+struct SimOptions {
+  int startHour = 9;
+  int startMinute = 58;
+  int minutes = 3;
+  SpeedProfile speed = SPEED_NORMAL;
+  bool reset = false;
+  bool warm = false;
+  bool verbose = false;
+  bool transitions = false;
+  const char *csvPath = NULL;
+  const char *tracePath = NULL;
+  const char *i2cLogPath = NULL;
+  SimI2CFaults faults;
+};
+
+static bool parseArgs(int argc, char **argv, SimOptions &opt) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    bool hasValue = (i + 1 < argc);
+
+    if (!strcmp(arg, "--start") && hasValue) {
+      if (sscanf(argv[++i], "%d:%d", &opt.startHour, &opt.startMinute) != 2)
+        return false;
+    } else if (!strcmp(arg, "--minutes") && hasValue) {
+      opt.minutes = atoi(argv[++i]);
+    } else if (!strcmp(arg, "--speed") && hasValue) {
+      const char *s = argv[++i];
+      if (!strcmp(s, "fast"))
+        opt.speed = SPEED_FAST;
+      else if (!strcmp(s, "normal"))
+        opt.speed = SPEED_NORMAL;
+      else if (!strcmp(s, "night"))
+        opt.speed = SPEED_NIGHT;
+      else
+        return false;
+    } else if (!strcmp(arg, "--reset")) {
+      opt.reset = true;
+    } else if (!strcmp(arg, "--warm")) {
+      opt.warm = true;
+    } else if (!strcmp(arg, "--verbose")) {
+      opt.verbose = true;
+    } else if (!strcmp(arg, "--transitions")) {
+      opt.transitions = true;
+    } else if (!strcmp(arg, "--csv") && hasValue) {
+      opt.csvPath = argv[++i];
+    } else if (!strcmp(arg, "--trace") && hasValue) {
+      opt.tracePath = argv[++i];
+    } else if (!strcmp(arg, "--i2c-log") && hasValue) {
+      opt.i2cLogPath = argv[++i];
+    } else if (!strcmp(arg, "--i2c-max-clock") && hasValue) {
+      opt.faults.maxClock = atol(argv[++i]);
+    } else if (!strcmp(arg, "--i2c-glitch-ppm") && hasValue) {
+      opt.faults.glitchPpm = atol(argv[++i]);
+    } else {
+      return false;
+    }
+  }
+  return opt.startHour >= 0 && opt.startHour < 24 && opt.startMinute >= 0 &&
+         opt.startMinute < 60 && opt.minutes >= 0;
+}
+
+static bool writeCsv(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return false;
+
+  fprintf(f, "time_us,address,reg,value\n");
+  const SimPCA9685 *boards[] = {&simHours, &simMinutes};
+  for (const SimPCA9685 *board : boards) {
+    for (const SimRegisterWrite &w : board->writes()) {
+      fprintf(f, "%llu,0x%02X,0x%02X,%u\n", (unsigned long long)w.timeUs,
+              w.address, w.reg, w.value);
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// Same lines as Trace.dump() on the clock's serial console
+static bool writeTrace(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return false;
+
+  uint16_t n = Trace.count();
+  fprintf(f, "# tymos-trace v1 events=%u lost=%lu\n", n,
+          (unsigned long)(Trace.total() - n));
+  TraceEvent e;
+  char line[64];
+  for (uint16_t i = 0; i < n && Trace.get(i, e); i++) {
+    TraceClass::format(e, line, sizeof(line));
+    fprintf(f, "%s\n", line);
+  }
+  fprintf(f, "# end\n");
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  SimOptions opt;
+  if (!parseArgs(argc, argv, opt)) {
+    fprintf(stderr,
+            "Usage: %s [--start HH:MM] [--minutes N] "
+            "[--speed fast|normal|night] [--reset | --warm] [--verbose] "
+            "[--transitions] "
+            "[--csv FILE] [--trace FILE] [--i2c-log FILE] "
+            "[--i2c-max-clock HZ] [--i2c-glitch-ppm N]\n",
+            argv[0]);
+    return 2;
+  }
+  Serial.setEcho(opt.verbose);
+
+  Wire.attach(&simHours);
+  Wire.attach(&simMinutes);
+  Wire.attach(&simRtc);
+  Wire.setFaults(opt.faults);
+  // Every transaction from boot on (compare runs with tymos_i2c_diff)
+  SimI2CLogWriter i2cLog;
+  if (opt.i2cLogPath) {
+    if (!i2cLog.open(opt.i2cLogPath)) {
+      fprintf(stderr, "Cannot write %s\n", opt.i2cLogPath);
+      return 1;
+    }
+    Wire.setTap(&i2cLog);
+  }
+  simRtc.setTime(DateTime(2025, 1, 1, opt.startHour, opt.startMinute, 0));
+  uint64_t rtcEpochUs = SimClock::nowUs();
+
+  auto wallStart = std::chrono::steady_clock::now();
+  Trace.enable(opt.tracePath != NULL);
+
+  // setup() without WiFi
+  Logger.begin();
+  Profiler.begin();
+  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+  I2CBus.begin();
+  pwmDriver.begin(PCA9685_ADDR_HOURS, PCA9685_ADDR_MINUTES, PCA9685_PWM_FREQ);
+  Calibration.begin();
+  motionServo.loadCalibration();
+  Settings.begin();
+  rtcDriver.begin();
+  Logger.info("Hardware Initialized. Current Temp: %.2f C",
+              rtcDriver.getTemperature());
+  DisplayState pose;
+  if (opt.reset) {
+    motionEngine.resetSequence();
+    for (int d = 0; d < 4; d++) {
+      pose.digits[d] = 8;
+    }
+    pose.separator = true;
+  } else {
+    if (opt.warm) {
+      // Reboot right after the start minute settled (e.g. OTA)
+      DisplayState last;
+      last.digits[DIGIT_DO] = opt.startHour / 10;
+      last.digits[DIGIT_UO] = opt.startHour % 10;
+      last.digits[DIGIT_DM] = opt.startMinute / 10;
+      last.digits[DIGIT_UM] = opt.startMinute % 10;
+      last.separator = true;
+      PoseStore.markSettled(last);
+    }
+    if (!PoseStore.load(pose)) {
+      motionEngine.homeQuick(pose);
+    }
+  }
+  Settings.setSpeed(opt.speed);
+  uint64_t bootUs = SimClock::nowUs();
+  motionTask.begin(pose);
+  displayManager.begin(pose);
+
+  // loop() until the requested number of minutes has elapsed
+  uint64_t endUs = SimClock::nowUs() + (uint64_t)opt.minutes * 60000000ULL;
+  uint64_t maxLoopUs = 0;
+  bool busy = motionTask.isBusy(); // begin() queued the first transition
+  uint64_t busySinceUs = SimClock::nowUs();
+  uint32_t transitions = 0;
+  int64_t totalSettleUs = 0;
+  int64_t minSettleUs = INT64_MAX;
+  int64_t maxSettleUs = INT64_MIN;
+  uint64_t totalDurationUs = 0;
+  uint64_t maxDurationUs = 0;
+  // Estimated supply current (MotionPower model) while moving
+  uint32_t peakMa = 0;
+  uint64_t chargeMaUs = 0; // Integral over the transition, mA * us
+  uint32_t maxPeakMa = 0;
+  uint64_t totalChargeMaUs = 0;
+
+  while (SimClock::nowUs() < endUs) {
+    uint64_t start = SimClock::nowUs();
+    // Both sides of the firmware, interleaved on one thread, with the
+    // control stages timed like controlLoop()
+    uint32_t t = Profiler.now();
+    rtcDriver.update();
+    t = Profiler.lap(PROF_RTC, t);
+    Settings.update();
+    t = Profiler.lap(PROF_SETTINGS, t);
+    motionTask.step();
+    t = Profiler.now();
+    displayManager.update();
+    Profiler.lap(PROF_DISPLAY, t);
+    delay(1);
+    uint64_t elapsed = SimClock::nowUs() - start;
+    if (elapsed > maxLoopUs)
+      maxLoopUs = elapsed;
+
+    bool nowBusy = motionTask.isBusy();
+    if (nowBusy && !busy) {
+      busySinceUs = start;
+      peakMa = 0;
+      chargeMaUs = 0;
+    }
+    if (nowBusy || busy) {
+      uint32_t ma = motionScheduler.getCurrentMa();
+      if (ma > peakMa)
+        peakMa = ma;
+      chargeMaUs += (uint64_t)ma * elapsed;
+    }
+    if (busy && !nowBusy) {
+      // Settle time relative to the nearest minute boundary of the RTC
+      // (negative = settled early)
+      uint64_t settledUs = SimClock::nowUs();
+      uint64_t sinceRtcUs = settledUs - rtcEpochUs;
+      uint64_t minuteIdx = (sinceRtcUs + 30000000ULL) / 60000000ULL;
+      int64_t settleUs =
+          (int64_t)sinceRtcUs - (int64_t)(minuteIdx * 60000000ULL);
+      uint64_t durationUs = settledUs - busySinceUs;
+
+      transitions++;
+      totalSettleUs += settleUs;
+      if (settleUs < minSettleUs)
+        minSettleUs = settleUs;
+      if (settleUs > maxSettleUs)
+        maxSettleUs = settleUs;
+      totalDurationUs += durationUs;
+      if (durationUs > maxDurationUs)
+        maxDurationUs = durationUs;
+      if (peakMa > maxPeakMa)
+        maxPeakMa = peakMa;
+      totalChargeMaUs += chargeMaUs;
+
+      if (opt.transitions) {
+        int minuteOfDay =
+            (opt.startHour * 60 + opt.startMinute + (int)minuteIdx) % 1440;
+        printf("transition=%02d:%02d settle_ms=%+.1f duration_ms=%.1f "
+               "peak_ma=%u avg_ma=%.0f\n",
+               minuteOfDay / 60, minuteOfDay % 60, settleUs / 1000.0,
+               durationUs / 1000.0, peakMa,
+               durationUs ? (double)chargeMaUs / durationUs : 0.0);
+      }
+    }
+    busy = nowBusy;
+  }
+
+  double wallMs = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - wallStart)
+                      .count();
+  const SimI2CStats &bus = Wire.stats();
+
+  printf("sim_time_s=%.3f\n", SimClock::nowUs() / 1e6);
+  printf("wall_time_ms=%.1f\n", wallMs);
+  printf("boot_ms=%.1f\n", bootUs / 1000.0);
+  printf("transitions=%u\n", transitions);
+  if (transitions) {
+    printf("settle_avg_ms=%+.1f\n", totalSettleUs / 1000.0 / transitions);
+    printf("settle_min_ms=%+.1f\n", minSettleUs / 1000.0);
+    printf("settle_max_ms=%+.1f\n", maxSettleUs / 1000.0);
+    printf("duration_avg_ms=%.1f\n", totalDurationUs / 1000.0 / transitions);
+    printf("duration_max_ms=%.1f\n", maxDurationUs / 1000.0);
+    printf("current_peak_ma=%u\n", maxPeakMa);
+    printf("current_avg_ma=%.0f\n",
+           totalDurationUs ? (double)totalChargeMaUs / totalDurationUs : 0.0);
+  }
+  printf("current_deferred_starts=%u\n", motionScheduler.getDeferredStarts());
+  printf("loop_max_us=%llu\n", (unsigned long long)maxLoopUs);
+  printf("i2c_transactions=%u\n", bus.transactions);
+  printf("i2c_bytes=%llu\n", (unsigned long long)bus.bytes);
+  printf("i2c_busy_ms=%.1f\n", bus.busTimeUs / 1000.0);
+  printf("i2c_nacks=%u\n", bus.nacks);
+  printf("i2c_timeouts=%u\n", bus.timeouts);
+  // Firmware-side view from the bus manager
+  I2CBusStats busStats;
+  I2CBus.getStats(busStats);
+  static const char *PRIO_KEYS[I2C_PRIO_COUNT] = {"servo", "rtc", "temp"};
+  printf("i2c_utilization_pct=%.2f\n",
+         busStats.elapsedUs ? busStats.busyUs * 100.0 / busStats.elapsedUs
+                            : 0.0);
+  printf("i2c_max_queued=%u\n", busStats.maxQueued);
+  printf("i2c_clock_khz=%u\n", busStats.clockHz / 1000);
+  printf("i2c_retries=%u\n", busStats.retries);
+  printf("i2c_recoveries=%u\n", busStats.recoveries);
+  printf("i2c_backoffs=%u\n", busStats.backoffs);
+  for (int p = 0; p < I2C_PRIO_COUNT; p++) {
+    const I2CPriorityStats &ps = busStats.priority[p];
+    printf("i2c_%s_txn=%u\n", PRIO_KEYS[p], ps.count);
+    printf("i2c_%s_latency_avg_us=%.1f\n", PRIO_KEYS[p],
+           ps.count ? (double)ps.totalLatencyUs / ps.count : 0.0);
+    printf("i2c_%s_latency_max_us=%u\n", PRIO_KEYS[p], ps.maxLatencyUs);
+    printf("i2c_%s_failed=%u\n", PRIO_KEYS[p], ps.errors);
+  }
+  // Loop profiler, whole run (virtual time: only I2C transfers and delays
+  // take time on the host)
+  for (int s = 0; s < PROF_STAGE_COUNT; s++) {
+    ProfileSummary p;
+    if (!Profiler.getSummary(s, p))
+      continue;
+    const char *name = ProfilerClass::stageName(s);
+    printf("prof_%s_p50_us=%u\n", name, p.p50Us);
+    printf("prof_%s_p99_us=%u\n", name, p.p99Us);
+    printf("prof_%s_max_us=%u\n", name, p.maxUs);
+  }
+  // Servos pulsing at once (the boards run unsynchronized, so their peaks
+  // can add up)
+  printf("pwm_peak_high=%u\n",
+         simHours.peakHighChannels() + simMinutes.peakHighChannels());
+  printf("rtc_reads=%u\n", simRtc.readCount());
+  printf("pca_register_writes=%zu\n",
+         simHours.writes().size() + simMinutes.writes().size());
+
+  if (opt.csvPath && !writeCsv(opt.csvPath)) {
+    fprintf(stderr, "Cannot write %s\n", opt.csvPath);
+    return 1;
+  }
+  if (opt.tracePath && !writeTrace(opt.tracePath)) {
+    fprintf(stderr, "Cannot write %s\n", opt.tracePath);
+    return 1;
+  }
+  Wire.setTap(NULL);
+  if (opt.i2cLogPath && !i2cLog.close()) {
+    fprintf(stderr, "Cannot write %s\n", opt.i2cLogPath);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,145 @@
+/**
+ * TyMos Clock - Calibration Override Checks
+ *
+ * Angle overrides are applied to every plan move, but the plans are only
+ * proven collision-safe for the default angles. Overrides that would put
+ * segment 2 or 6 at rest inside the range segment 7 sweeps, or active
+ * outside it, must be rejected by MotionCalibration::set(), by
+ * Settings.setAngleOverride() and when loading a stored calibration.
+ *
+ * Usage: test_calibration (exit status 0 pass, 1 fail)
+ */
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "config.h"
+#include "core_settings_manager.h"
+#include "motion_calibration.h"
+#include "motion_segment_map.h"
+#include "utils_logger.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);                   \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+static ServoCalibration withAngles(int16_t active, int16_t rest) {
+  ServoCalibration cal;
+  cal.minPulseUs = SERVO_MIN_PULSE_US;
+  cal.maxPulseUs = SERVO_MAX_PULSE_US;
+  cal.active = active;
+  cal.rest = rest;
+  return cal;
+}
+
+static void channelOf(int segment, uint8_t &board, uint8_t &channel) {
+  MotionSegmentMap::getChannel(DIGIT_UM, segment, board, channel);
+}
+
+static void testSegmentLookup() {
+  for (int d = DIGIT_DO; d <= DIGIT_UM; d++) {
+    for (int seg = 1; seg <= 7; seg++) {
+      uint8_t b, c;
+      MotionSegmentMap::getChannel((DigitPosition)d, seg, b, c);
+      CHECK(MotionSegmentMap::getSegment(b, c) == seg);
+    }
+  }
+  uint8_t b, c;
+  MotionSegmentMap::getChannelSeparator(b, c);
+  CHECK(MotionSegmentMap::getSegment(b, c) == 0);
+}
+
+static void testSet() {
+  uint8_t b, c;
+  Calibration.resetDefaults();
+
+  // Segment 2: blocked [70, 99] while segment 7 moves
+  channelOf(2, b, c);
+  CHECK(!Calibration.set(b, c, withAngles(CAL_ANGLE_DEFAULT, 85)));
+  CHECK(!Calibration.set(b, c, withAngles(110, CAL_ANGLE_DEFAULT)));
+  CHECK(Calibration.get(b, c).rest == CAL_ANGLE_DEFAULT);
+  CHECK(Calibration.get(b, c).active == CAL_ANGLE_DEFAULT);
+  CHECK(Calibration.set(b, c, withAngles(75, 160)));
+
+  // Segment 6 (inverted): blocked [71, 100]
+  channelOf(6, b, c);
+  CHECK(!Calibration.set(b, c, withAngles(CAL_ANGLE_DEFAULT, 80)));
+  CHECK(!Calibration.set(b, c, withAngles(60, CAL_ANGLE_DEFAULT)));
+  CHECK(Calibration.set(b, c, withAngles(95, 10)));
+
+  // Segments without a rule only get the range check
+  channelOf(1, b, c);
+  CHECK(Calibration.set(b, c, withAngles(CAL_ANGLE_DEFAULT, 85)));
+  CHECK(!Calibration.set(b, c, withAngles(CAL_ANGLE_DEFAULT, 181)));
+  Calibration.resetDefaults();
+}
+
+static void testSettings() {
+  uint8_t b, c;
+  channelOf(2, b, c);
+  CHECK(!Settings.setAngleOverride(b, c, CAL_ANGLE_DEFAULT, 90));
+  CHECK(Calibration.get(b, c).rest == CAL_ANGLE_DEFAULT);
+  CHECK(Settings.setAngleOverride(b, c, CAL_ANGLE_DEFAULT, 150));
+  CHECK(Calibration.get(b, c).rest == 150);
+  Calibration.resetDefaults();
+}
+
+static void testStored() {
+  // A record saved by a firmware without the check: the unsafe channel is
+  // reset on load, the others are kept
+  uint8_t b2, c2, b1, c1;
+  channelOf(2, b2, c2);
+  channelOf(1, b1, c1);
+  Calibration.resetDefaults();
+  CHECK(Calibration.set(b1, c1, withAngles(CAL_ANGLE_DEFAULT, 150)));
+  CHECK(Calibration.set(b2, c2, withAngles(CAL_ANGLE_DEFAULT, 150)));
+  CHECK(Calibration.save());
+
+  // Patch the segment 2 rest angle into the blocked range in NVS
+  Preferences prefs;
+  CHECK(prefs.begin("tymos-cal", false));
+  size_t len = prefs.getBytesLength("servo");
+  uint8_t raw[1024];
+  CHECK(len > 0 && len <= sizeof(raw));
+  if (len == 0 || len > sizeof(raw)) {
+    prefs.end();
+    return;
+  }
+  prefs.getBytes("servo", raw, len);
+  // version, then channels[board][16]
+  size_t offset = sizeof(uint16_t) +
+                  (((b2 == PCA9685_ADDR_HOURS ? 0 : 1) * 16) + c2) *
+                      sizeof(ServoCalibration) +
+                  offsetof(ServoCalibration, rest);
+  int16_t unsafeRest = 85;
+  memcpy(raw + offset, &unsafeRest, sizeof(unsafeRest));
+  prefs.putBytes("servo", raw, len);
+  prefs.end();
+
+  Calibration.begin();
+  CHECK(Calibration.get(b2, c2).rest == CAL_ANGLE_DEFAULT);
+  CHECK(Calibration.get(b1, c1).rest == 150);
+  Calibration.resetDefaults();
+}
+
+int main() {
+  Serial.setEcho(false);
+  Logger.begin();
+
+  testSegmentLookup();
+  testSet();
+  testSettings();
+  testStored();
+
+  printf("%s (%d failure%s)\n", failures ? "FAILED" : "passed", failures,
+         failures == 1 ? "" : "s");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+"""Compare two tymos_day reports and flag regressions.
+
+Every reported metric is a cost (more travel, more bus traffic, later or
+longer flips, longer loop stalls are all worse), so a key regresses when it
+grows by more than the tolerance. Transition counts must match exactly;
+wall-clock keys are ignored.
+
+Usage: day_compare.py baseline.txt candidate.txt [--tolerance PCT]
+Exit status: 0 no regression, 1 regression, 2 bad input.
+"""
+
+import argparse
+import sys
+
+IGNORED = ("wall_time_ms", "sim_time_s")
+
+
+def load(path):
+    values = {}
+    with open(path) as f:
+        for line in f:
+            key, sep, value = line.strip().partition("=")
+            if not sep or key in IGNORED:
+                continue
+            try:
+                values[key] = float(value)
+            except ValueError:
+                continue
+    return values
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("candidate")
+    parser.add_argument("--tolerance", type=float, default=1.0,
+                        help="allowed growth in percent (default 1)")
+    args = parser.parse_args()
+
+    old = load(args.baseline)
+    new = load(args.candidate)
+    if not old or not new:
+        print("Empty report", file=sys.stderr)
+        return 2
+
+    regressions = 0
+    print("%-32s %14s %14s %9s" % ("metric", "baseline", "candidate", "change"))
+    for key in sorted(set(old) | set(new)):
+        if key not in old or key not in new:
+            print("%-32s %14s %14s %9s" % (key, old.get(key, "-"),
+                                             new.get(key, "-"), "missing"))
+            regressions += 1
+            continue
+        a, b = old[key], new[key]
+        delta = b - a
+        pct = delta * 100.0 / abs(a) if a else (0.0 if not delta else 100.0)
+        if key.endswith("_transitions"):
+            bad = delta != 0
+        else:
+            bad = delta > 0 and pct > args.tolerance
+        regressions += bad
+        print("%-32s %14.1f %14.1f %+8.1f%%%s" % (key, a, b, pct,
+                                                 "  <-- worse" if bad else ""))
+
+    print("%d regression(s)" % regressions)
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
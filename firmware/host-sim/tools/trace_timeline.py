@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""Convert a TyMos trace dump into a Chrome trace timeline.
+
+Input is the text printed by Trace.dump() on the serial console ('d'
+command) or written by `tymos_sim --trace FILE`. Serial logs may be passed
+as-is: lines outside the "# tymos-trace" ... "# end" block are ignored.
+
+Output is Chrome trace-event JSON, viewable in chrome://tracing or
+https://ui.perfetto.dev:
+  - one track per scheduler lane with its phases and servo moves
+  - one track per I2C priority with every transaction
+  - instant events for servo commands, PWM register changes, detaches,
+    collision plans and software clock seconds
+
+Usage: trace_timeline.py dump.txt [-o timeline.json]
+"""
+
+import argparse
+import json
+import sys
+
+LANES = {0: "lane DO", 1: "lane UO", 2: "lane DM", 3: "lane UM", 4: "lane SEP"}
+PRIORITIES = {0: "i2c servo", 1: "i2c rtc", 2: "i2c temp"}
+
+PID = 1
+
+
+def parse(lines):
+    """Yield (time_us, name, a, b, c) from the dump block(s)."""
+    inside = False
+    for line in lines:
+        line = line.strip()
+        if line.startswith("# tymos-trace"):
+            inside = True
+            continue
+        if line == "# end":
+            inside = False
+            continue
+        if not inside or not line.startswith("T "):
+            continue
+        parts = line.split()
+        if len(parts) != 6:
+            continue
+        yield int(parts[1]), parts[2], int(parts[3]), int(parts[4]), int(parts[5])
+
+
+def unwrap(events):
+    """micros() wraps every 71.6 minutes: make timestamps monotonic."""
+    offset = 0
+    last = None
+    for t, name, a, b, c in events:
+        if last is not None and t + offset < last - (1 << 31):
+            offset += 1 << 32
+        last = t + offset
+        yield last, name, a, b, c
+
+
+def convert(events):
+    out = []
+    threads = {}
+
+    def tid(track):
+        if track not in threads:
+            threads[track] = len(threads) + 1
+        return threads[track]
+
+    def span(phase, track, name, t, args=None):
+        ev = {"ph": phase, "pid": PID, "tid": tid(track), "name": name, "ts": t}
+        if args:
+            ev["args"] = args
+        out.append(ev)
+
+    def instant(track, name, t, args):
+        out.append({"ph": "i", "s": "t", "pid": PID, "tid": tid(track),
+                    "name": name, "ts": t, "args": args})
+
+    for t, name, a, b, c in events:
+        if name in ("phase_begin", "phase_end"):
+            span("B" if name == "phase_begin" else "E",
+                 LANES.get(a, "lane %d" % a), "phase %d" % b, t)
+        elif name in ("move_start", "move_end"):
+            track = "%s moves" % LANES.get(a, "lane %d" % a)
+            label = "0x%02X ch%d" % (b >> 8, b & 0xFF)
+            if name == "move_start":
+                span("B", track, label, t, {"planned_ms": c})
+            else:
+                span("E", track, label, t)
+        elif name in ("i2c_begin", "i2c_end"):
+            track = PRIORITIES.get(b, "i2c prio %d" % b)
+            if name == "i2c_begin":
+                span("B", track, "0x%02X" % a, t, {"tag": "0x%06X" % c})
+            else:
+                span("E", track, "0x%02X" % a, t, {"result": c})
+        elif name in ("servo_angle", "servo_pulse", "servo_detach"):
+            instant("servo 0x%02X" % a, name, t, {"channel": b, "value": c})
+        elif name == "pwm_set":
+            instant("pwm 0x%02X" % a, "ch%d" % b, t, {"off": c})
+        elif name == "collision_plan":
+            frm, to = (b >> 8), (b & 0xFF)
+            instant(LANES.get(a, "lane %d" % a), "plan", t,
+                    {"from": frm if frm < 10 else -1,
+                     "to": to if to < 10 else -1, "moves": c})
+        elif name == "rtc_now":
+            instant("clock", "second", t, {"unix": c})
+
+    for track, thread in threads.items():
+        out.append({"ph": "M", "pid": PID, "tid": thread, "name": "thread_name",
+                    "args": {"name": track}})
+    return {"traceEvents": out, "displayTimeUnit": "ms"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("dump", help="trace dump (serial log or sim file)")
+    parser.add_argument("-o", "--output", help="JSON file (default stdout)")
+    args = parser.parse_args()
+
+    with open(args.dump, errors="replace") as f:
+        timeline = convert(unwrap(parse(f)))
+
+    if not timeline["traceEvents"]:
+        print("No trace events found", file=sys.stderr)
+        return 1
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(timeline, f)
+    else:
+        json.dump(timeline, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())